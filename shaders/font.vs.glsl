@@ -1,13 +1,16 @@
 #version 330 core
 /* simpleGL freetype font vertex shader */
 layout (location = 0) in vec4 vertex;	// vec4 = vec2 pos (xy) + vec2 tex (zw)
+layout (location = 1) in vec3 in_color;
 out vec2 TexCoords;
+out vec3 TextColor;
 
 uniform mat4 projection;
-uniform mat4 transform;
 
 void main()
 {
-	gl_Position = projection * transform * vec4(vertex.xy, 0.0, 1.0);
+	// Positions arrive already transformed, texts are batched into one draw
+	gl_Position = projection * vec4(vertex.xy, 0.0, 1.0);
 	TexCoords = vertex.zw;
+	TextColor = in_color;
 }
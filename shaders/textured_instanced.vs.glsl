@@ -0,0 +1,25 @@
+#version 330
+
+// Input attributes
+in vec3 in_position;
+in vec2 in_texcoord;
+
+// Per-instance attributes
+in mat3 in_transform;
+in vec3 in_color;
+in vec4 in_uv_rect;
+
+// Passed to fragment shader
+out vec2 texcoord;
+out vec3 tint;
+
+// Application data
+uniform mat3 projection;
+
+void main()
+{
+	texcoord = in_uv_rect.xy + in_texcoord * in_uv_rect.zw;
+	tint = in_color;
+	vec3 pos = projection * in_transform * vec3(in_position.xy, 1.0);
+	gl_Position = vec4(pos.xy, in_position.z, 1.0);
+}
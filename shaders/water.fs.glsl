@@ -6,6 +6,8 @@ uniform float darken_screen_factor;
 uniform float light_up;
 
 uniform bool distort_on;
+// Part of the screen texture the scene was drawn to, less than 1 below full resolution
+uniform vec2 uv_scale;
 
 in vec2 texcoord;
 
@@ -58,6 +60,9 @@ vec4 fade_color(vec4 in_color)
 void main()
 {
 	vec2 coord = distort(texcoord);
+	// Keep the filter from reading past the drawn part
+	vec2 half_texel = 0.5 / vec2(textureSize(screen_texture, 0));
+	coord = min(coord * uv_scale, uv_scale - half_texel);
 
     vec4 in_color = texture(screen_texture, coord);
     color = color_shift(in_color);
@@ -1,6 +1,7 @@
 // internal
 #include "ai_system.hpp"
 #include "world_init.hpp"
+#include "wall_edges.hpp"
 #include <queue>
 
 void AISystem::init(RenderSystem *renderSystem) {
@@ -109,10 +110,7 @@ void AISystem::step(float elapsed_ms)
             }
 		} else if (enemyState == EnemyState::SPAWN_MINIONS) {
 			Motion &enemyMotion = registry.enemyMotions.get(enemy);
-
-			Necromancer& necroComp = registry.necromancers.get(enemy);
-			necroComp.centerPosition = enemyMotion.position;
-			necroComp.spawningMinions = true;
+			spawn_minions(enemyMotion.position);
 
 			// Reset time
             ReloadTime &counter = registry.reloadTimes.get(enemy);
@@ -121,15 +119,6 @@ void AISystem::step(float elapsed_ms)
 		}
 	}
 
-	// Spawn minions outside of loop, or it will crash
-	for (Entity &necro: registry.necromancers.entities) {
-		Necromancer& necroComp = registry.necromancers.get(necro);
-		if (necroComp.spawningMinions) {
-			spawn_minions(necroComp.centerPosition);
-			necroComp.spawningMinions = false;
-		}
-	}
-
 	// Deal with teleportation animation with Bezier Curve
 	for (Entity& teleporting: registry.teleporting.entities) {
 		Motion &bossMotion = registry.enemyMotions.get(teleporting);
@@ -157,13 +146,16 @@ void AISystem::spawn_minions(glm::vec2 &position)
 		vec2(position.x, position.y - minionDistance),
 		vec2(position.x, position.y + minionDistance)};
 
+	// Called while iterating the enemies, so the minions are created at the next flush
+	RenderSystem *renderer = renderer_arg;
 	for (int i = 0; i < 4; i++) {
 		if (wall_distance_helper(possiblePositions[i])) {
+			vec2 minionPosition = possiblePositions[i];
 			int minionTypeRand = rand() % 2;
 			if (minionTypeRand == 0) {
-				createMeleeMinion(renderer_arg, possiblePositions[i]);
+				registry.defer([renderer, minionPosition]() { createMeleeMinion(renderer, minionPosition); });
 			} else {
-				createRangedMinion(renderer_arg, possiblePositions[i]);
+				registry.defer([renderer, minionPosition]() { createRangedMinion(renderer, minionPosition); });
 			}
 		}
 	}
@@ -303,38 +295,13 @@ void AISystem::update_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder
 
 // Perform a light of sight check to see if there are any obstacles between the ranged enemy and the player
 bool AISystem::line_of_sight_check(Entity &enemy, Motion &playerMotion) {
-	Motion& enemyMotion = registry.enemyMotions.get(enemy);
-	vec2 deltaEnemyPlayer = enemyMotion.position - playerMotion.position;
-	for (Entity &obstacle: registry.exposedWallMotions.entities) {
-		Motion &wallMotion = registry.exposedWallMotions.get(obstacle);
-		if (line_box_collision(enemyMotion, wallMotion, deltaEnemyPlayer)) {
-			return true;
-		}
+	if (registry.gridMaps.size() == 0) {
+		return false;
 	}
-	return false;
-}
-
-// Whether the line and AABB intersect, not really the smartest method, iterate through points on the line and return true if it intersects
-bool AISystem::line_box_collision(Motion &enemyMotion, Motion &obstacleMotion, vec2 &directionDelta) {
-	vec2 normalizedDelta = normalize(directionDelta);
-	vec2 increment = los_increment * normalizedDelta;
-	vec2 curr = vec2(0, 0);
-	vec2 bounding_box = vec2(abs(obstacleMotion.scale.x), abs(obstacleMotion.scale.y));
-	float left = obstacleMotion.position.x - bounding_box.x/2;
-	float right = obstacleMotion.position.x + bounding_box.x/2;
-	float bot = obstacleMotion.position.y + bounding_box.y/2;
-	float top = obstacleMotion.position.y - bounding_box.y/2;
-	// Added to prevent infinite loops
-	int tries = 0;
-	while ((length(curr) < length(directionDelta)) && tries < 1000) {
-		curr += increment;
-		tries += 1;
-		vec2 curr_pos = enemyMotion.position + curr;
-		if (curr_pos.x > left && curr_pos.x < right && curr_pos.y > top && curr_pos.y < bot) {
-			return true;
-		}
-	}
-	return false;
+	Motion& enemyMotion = registry.enemyMotions.get(enemy);
+	// One exact segment test per wall edge instead of stepping along the line through every wall box
+	const GridMap& gridMap = registry.gridMaps.components[0];
+	return segmentBlocked(enemyMotion.position, playerMotion.position, gridMap.wall_edges);
 }
 
 // Comparator
@@ -31,7 +31,6 @@ private:
     void update_path(Motion &playerMotion, Motion &enemyMotion, Pathfinder &pathfinder);
     void stop_and_melee(Entity &enemy, MeleeAttack &counter, float elapsed_ms, Motion &playerMotion, Entity &playerEntity);
     bool line_of_sight_check(Entity &enemy, Motion &playerMotion);
-    bool line_box_collision(Motion &enemyMotion, Motion &obstacleMotion, vec2 &directionDelta);
     vec2 quadratic_bezier(float t, float max_time);
     void astar_pathfinding(GridMap& grid, GridNode* startNode, GridNode* endNode, Pathfinder &pathfinder);
     void reset_grid(GridMap &gridMap);
@@ -50,7 +49,6 @@ private:
     const float minDistanceToPlayer = 80.0f;
     const float meleeDistance = 100.0f;
     const float distanceBetweenEnemies = 30.0f;
-    const float los_increment = 50.0f;
     const float shotgun_angle = M_PI/8.0f;
     const float tp_to_player_range = 300.0f;
     const float minionDistance = 90.0f;
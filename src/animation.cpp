@@ -0,0 +1,31 @@
+#include "animation.hpp"
+
+void advanceAnimation(Animation &anim, bool running, float elapsed_seconds)
+{
+    if (!anim.is_playing)
+        return;
+    if (!running)
+    {
+        anim.current_time = 0.f;
+        anim.current_frame = 0;
+        return;
+    }
+
+    anim.current_time += elapsed_seconds;
+    if (anim.current_time < anim.frame_time)
+        return;
+    anim.current_time = 0.f;
+    anim.current_frame++;
+    if (anim.current_frame >= anim.num_frames)
+    {
+        if (anim.loop)
+        {
+            anim.current_frame = 0;
+        }
+        else
+        {
+            anim.current_frame = anim.num_frames - 1;
+            anim.is_playing = false;
+        }
+    }
+}
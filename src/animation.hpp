@@ -0,0 +1,19 @@
+#pragma once
+
+// Sprite sheet animation of an entity, frames side by side along x
+struct Animation
+{
+    float current_time = 0.f;
+    float frame_time = 0.2f;
+    int current_frame = 0;
+    int num_frames;
+    int sprite_width;
+    int sprite_height;
+    bool is_playing = true;
+    bool loop = true;
+};
+
+// Moves a playing animation elapsed_seconds on. running is whether its owner is doing
+// something that animates it, otherwise it is held on the first frame. A finished
+// animation that does not loop stays on its last frame and stops playing.
+void advanceAnimation(Animation &anim, bool running, float elapsed_seconds);
@@ -0,0 +1,273 @@
+#include "asset_archive.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+AssetArchive::~AssetArchive()
+{
+    close();
+}
+
+bool AssetArchive::open(const std::string &path, const std::string &source_dir)
+{
+    close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping == NULL)
+    {
+        CloseHandle(file);
+        return false;
+    }
+    m_base = (const unsigned char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (m_base == nullptr)
+    {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+    m_file = file;
+    m_mapping = mapping;
+    m_size = (size_t)file_size.QuadPart;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    void *mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping keeps its own reference to the file
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+        return false;
+    m_base = (const unsigned char *)mapped;
+    m_size = (size_t)st.st_size;
+#endif
+
+    // Validate everything up front so lookups never have to
+    AssetArchiveHeader header;
+    if (m_size < sizeof(header))
+    {
+        fprintf(stderr, "Asset archive %s is truncated\n", path.c_str());
+        close();
+        return false;
+    }
+    memcpy(&header, m_base, sizeof(header));
+    if (memcmp(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(header.magic)) != 0 || header.version != ASSET_ARCHIVE_VERSION)
+    {
+        fprintf(stderr, "Asset archive %s has the wrong format or version, rebake it\n", path.c_str());
+        close();
+        return false;
+    }
+    size_t toc_end = sizeof(header) + (size_t)header.entry_count * sizeof(AssetTocEntry);
+    if (toc_end > m_size)
+    {
+        fprintf(stderr, "Asset archive %s is truncated\n", path.c_str());
+        close();
+        return false;
+    }
+
+    const AssetTocEntry *toc = (const AssetTocEntry *)(m_base + sizeof(header));
+    m_toc.reserve(header.entry_count);
+    unsigned int stale = 0;
+    for (uint32_t i = 0; i < header.entry_count; i++)
+    {
+        const AssetTocEntry &entry = toc[i];
+        bool valid = entry.offset >= toc_end && entry.offset <= m_size && entry.size <= m_size - entry.offset;
+        switch ((ASSET_TYPE)entry.type)
+        {
+        case ASSET_TYPE::RAW:
+        case ASSET_TYPE::SHADER:
+            break;
+        case ASSET_TYPE::IMAGE_RGBA:
+            valid = valid && entry.width > 0 && entry.height > 0 &&
+                    entry.size == (uint64_t)entry.width * entry.height * 4;
+            break;
+        case ASSET_TYPE::MESH:
+            valid = valid && entry.size >= sizeof(AssetMeshHeader);
+            break;
+        default:
+            valid = false;
+        }
+        if (!valid)
+        {
+            fprintf(stderr, "Asset archive %s has a bad entry\n", path.c_str());
+            close();
+            return false;
+        }
+
+        std::string name(entry.name, strnlen(entry.name, ASSET_NAME_LENGTH));
+        int64_t mtime;
+        uint64_t size;
+        if (!source_dir.empty() && assetSourceStamp(source_dir + name, mtime, size) &&
+            (mtime != entry.source_mtime || size != entry.source_size))
+        {
+            stale++;
+            continue;
+        }
+        m_toc[name] = &entry;
+    }
+    if (stale > 0)
+        printf("%u assets changed since %s was baked, loading them from the loose files\n", stale, path.c_str());
+    return true;
+}
+
+bool AssetArchive::meshHeader(const AssetTocEntry &entry, size_t vertex_size, AssetMeshHeader &out) const
+{
+    if (entry.type != (uint32_t)ASSET_TYPE::MESH || entry.size < sizeof(out))
+        return false;
+    memcpy(&out, data(entry), sizeof(out));
+    uint64_t expected = sizeof(out) + (uint64_t)out.vertex_count * vertex_size +
+                        ((uint64_t)out.vertex_index_count + out.uv_index_count) * sizeof(uint16_t);
+    return expected == entry.size;
+}
+
+void AssetArchive::close()
+{
+    m_toc.clear();
+    if (m_base == nullptr)
+        return;
+#ifdef _WIN32
+    UnmapViewOfFile(m_base);
+    CloseHandle((HANDLE)m_mapping);
+    CloseHandle((HANDLE)m_file);
+    m_mapping = nullptr;
+    m_file = nullptr;
+#else
+    munmap((void *)m_base, m_size);
+#endif
+    m_base = nullptr;
+    m_size = 0;
+}
+
+const AssetTocEntry *AssetArchive::find(const std::string &name) const
+{
+    auto it = m_toc.find(name);
+    if (it == m_toc.end())
+        return nullptr;
+    return it->second;
+}
+
+void AssetArchiveWriter::add(const std::string &name, const std::string &source_path, ASSET_TYPE type,
+                             const void *bytes, size_t size, uint32_t width, uint32_t height)
+{
+    assert(name.size() < ASSET_NAME_LENGTH);
+    PendingEntry pending;
+    memset(&pending.entry, 0, sizeof(pending.entry));
+    memcpy(pending.entry.name, name.c_str(), name.size());
+    pending.entry.type = (uint32_t)type;
+    pending.entry.width = width;
+    pending.entry.height = height;
+    pending.entry.size = size;
+    assetSourceStamp(source_path, pending.entry.source_mtime, pending.entry.source_size);
+    const unsigned char *begin = (const unsigned char *)bytes;
+    pending.bytes.assign(begin, begin + size);
+    m_entries.push_back(std::move(pending));
+}
+
+static size_t alignBlob(size_t offset)
+{
+    return (offset + ASSET_BLOB_ALIGNMENT - 1) & ~(ASSET_BLOB_ALIGNMENT - 1);
+}
+
+bool AssetArchiveWriter::write(const std::string &path) const
+{
+    AssetArchiveHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ASSET_ARCHIVE_MAGIC, sizeof(header.magic));
+    header.version = ASSET_ARCHIVE_VERSION;
+    header.entry_count = (uint32_t)m_entries.size();
+
+    // Lay the blobs out after the table of contents
+    std::vector<AssetTocEntry> toc(m_entries.size());
+    size_t offset = alignBlob(sizeof(header) + toc.size() * sizeof(AssetTocEntry));
+    for (size_t i = 0; i < m_entries.size(); i++)
+    {
+        toc[i] = m_entries[i].entry;
+        toc[i].offset = offset;
+        offset = alignBlob(offset + m_entries[i].bytes.size());
+    }
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1;
+    if (!toc.empty())
+        ok = ok && fwrite(toc.data(), sizeof(AssetTocEntry), toc.size(), file) == toc.size();
+
+    static const unsigned char zeros[ASSET_BLOB_ALIGNMENT] = {};
+    size_t written = sizeof(header) + toc.size() * sizeof(AssetTocEntry);
+    for (size_t i = 0; i < m_entries.size() && ok; i++)
+    {
+        size_t gap = (size_t)toc[i].offset - written;
+        ok = ok && (gap == 0 || fwrite(zeros, 1, gap, file) == gap);
+        const std::vector<unsigned char> &bytes = m_entries[i].bytes;
+        ok = ok && (bytes.empty() || fwrite(bytes.data(), 1, bytes.size(), file) == bytes.size());
+        written = (size_t)toc[i].offset + bytes.size();
+    }
+    ok = (fclose(file) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "Failed writing %s\n", path.c_str());
+    return ok;
+}
+
+bool assetSourceStamp(const std::string &path, int64_t &mtime, uint64_t &size)
+{
+#ifdef _WIN32
+    struct _stat64 st;
+    if (_stat64(path.c_str(), &st) != 0)
+        return false;
+#else
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+        return false;
+#endif
+    mtime = (int64_t)st.st_mtime;
+    size = (uint64_t)st.st_size;
+    return true;
+}
+
+std::string assetName(const std::string &project_dir, const std::string &path)
+{
+    std::string name = path;
+    if (name.compare(0, project_dir.size(), project_dir) == 0)
+        name.erase(0, project_dir.size());
+
+    std::string out;
+    out.reserve(name.size());
+    for (char c : name)
+    {
+        if (c == '\\')
+            c = '/';
+        if (c == '/' && (out.empty() || out.back() == '/'))
+            continue;
+        out.push_back(c);
+    }
+    return out;
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Packed asset archive, written offline by tools/asset_baker.cpp and memory mapped at startup.
+// Layout: header, table of contents, then every blob aligned to ASSET_BLOB_ALIGNMENT.
+// No GL in here so the baker can link it without a context.
+
+const char ASSET_ARCHIVE_MAGIC[4] = {'R', 'R', 'P', 'K'};
+const uint32_t ASSET_ARCHIVE_VERSION = 2;
+const size_t ASSET_BLOB_ALIGNMENT = 16;
+const size_t ASSET_NAME_LENGTH = 96;
+
+enum class ASSET_TYPE : uint32_t
+{
+    RAW = 0,        // bytes as they are on disk (fonts)
+    IMAGE_RGBA = 1, // decoded RGBA8, already flipped for glTexImage2D
+    MESH = 2,       // AssetMeshHeader followed by the vertex and index arrays
+    SHADER = 3      // GLSL source, not null terminated
+};
+
+struct AssetArchiveHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t entry_count;
+    uint32_t reserved;
+};
+
+struct AssetTocEntry
+{
+    char name[ASSET_NAME_LENGTH]; // path relative to the project, e.g. "data/textures/wall.png"
+    uint32_t type;
+    uint32_t width; // images only
+    uint32_t height;
+    uint32_t reserved;
+    uint64_t offset; // from the start of the archive
+    uint64_t size;
+    // Modification time and size of the file the entry was baked from
+    int64_t source_mtime;
+    uint64_t source_size;
+};
+
+// Followed by vertex_count TexturedVertex, then the vertex and uv uint16_t indices
+struct AssetMeshHeader
+{
+    uint32_t vertex_count;
+    uint32_t vertex_index_count;
+    uint32_t uv_index_count;
+    float original_size[2];
+};
+
+// Read only view of an archive. Blobs point straight into the mapping and stay
+// valid until close(), nothing is copied on open.
+class AssetArchive
+{
+public:
+    AssetArchive() = default;
+    AssetArchive(const AssetArchive &) = delete;
+    AssetArchive &operator=(const AssetArchive &) = delete;
+    ~AssetArchive();
+
+    // Returns false (and leaves the archive closed) if the file is missing or malformed.
+    // With a source_dir, entries whose file there changed since baking are left out so
+    // they load from the loose file. Entries whose file is gone are kept.
+    bool open(const std::string &path, const std::string &source_dir = "");
+    void close();
+    bool isOpen() const { return m_base != nullptr; }
+
+    // nullptr if the archive is closed or has no such entry
+    const AssetTocEntry *find(const std::string &name) const;
+    const unsigned char *data(const AssetTocEntry &entry) const { return m_base + entry.offset; }
+    // Header of a MESH entry, false unless its arrays of vertex_size byte vertices and
+    // uint16_t indices exactly fill the entry
+    bool meshHeader(const AssetTocEntry &entry, size_t vertex_size, AssetMeshHeader &out) const;
+    size_t entryCount() const { return m_toc.size(); }
+
+private:
+    const unsigned char *m_base = nullptr;
+    size_t m_size = 0;
+    std::unordered_map<std::string, const AssetTocEntry *> m_toc;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
+
+// Collects blobs in memory and writes them out in one go
+class AssetArchiveWriter
+{
+public:
+    // source_path is the file the bytes came from, stamped so a changed file is noticed
+    void add(const std::string &name, const std::string &source_path, ASSET_TYPE type,
+             const void *bytes, size_t size, uint32_t width = 0, uint32_t height = 0);
+    bool write(const std::string &path) const;
+
+private:
+    struct PendingEntry
+    {
+        AssetTocEntry entry;
+        std::vector<unsigned char> bytes;
+    };
+    std::vector<PendingEntry> m_entries;
+};
+
+// Modification time and size of a file, false if it does not exist
+bool assetSourceStamp(const std::string &path, int64_t &mtime, uint64_t &size);
+
+// Entry name of a file under project_dir: the relative path with doubled and leading slashes removed
+std::string assetName(const std::string &project_dir, const std::string &path);
@@ -4,6 +4,8 @@
 #include <vector>
 #include <unordered_map>
 #include "../ext/stb_image/stb_image.h"
+#include "visibility.hpp"
+#include "animation.hpp"
 
 // Player component
 struct Player
@@ -56,10 +58,6 @@ struct Health
     }
 };
 
-struct HealthBar
-{
-};
-
 struct LineOfSight
 {
     float ray_distance = 300;
@@ -100,8 +98,6 @@ struct Boss
 
 struct Necromancer
 {
-    bool spawningMinions = false;
-    vec2 centerPosition = vec2(0.0f, 0.0f);
 };
 
 struct Teleporter
@@ -229,6 +225,7 @@ struct Mesh
     std::vector<TexturedVertex> vertices;
     std::vector<uint16_t> vertex_indices;
     std::vector<uint16_t> uv_indices;
+    unsigned int num_indices = 0; // of the uploaded index buffer, so draws need not query it
 };
 
 struct LightUp
@@ -236,32 +233,6 @@ struct LightUp
     float timer = 2.5f;
 };
 
-struct Animation
-{
-    float current_time = 0.f;
-    float frame_time = 0.2f;
-    int current_frame = 0;
-    int num_frames;
-    int sprite_width;
-    int sprite_height;
-    bool is_playing = true;
-    bool loop = true;
-};
-
-struct Ray
-{
-    vec2 pos;
-    vec2 direction;
-};
-
-// In parametric form: p + t * direction
-struct LineSegment
-{
-    vec2 pos;
-    vec2 direction;
-    int t;
-};
-
 // font character structure
 struct Character
 {
@@ -270,6 +241,13 @@ struct Character
     glm::ivec2 Bearing;     // Offset from baseline to left/top of glyph
     unsigned int Advance;   // Offset to advance to next glyph
     char character;
+    glm::vec4 uv_rect;      // Offset (xy) and size (zw) of the glyph in the font atlas
+};
+
+// Glyph quads of a string at one scale, laid out once and reused every frame
+struct TextLayout
+{
+    std::vector<glm::vec4> vertices; // 6 per glyph: xy offset from the pen start, zw atlas uv
 };
 
 struct Text
@@ -280,24 +258,19 @@ struct Text
     float scale;
     float timer = 0.2f;
     bool timed = true;
+    // Set whenever text or scale changes so the renderer looks the layout up again
+    bool dirty = true;
+    const TextLayout *layout = nullptr;
+    unsigned int layout_generation = 0;
 };
 
-struct TextRenderRequest
-{
-    std::string text;
-    float x;
-    float y;
-    float scale;
-    glm::vec3 color;
-    glm::mat4 transform;
-
-    TextRenderRequest(std::string t, float px, float py, float s, const glm::vec3 c, const glm::mat4 trans)
-        : text(t), x(px), y(py), scale(s), color(c), transform(trans) {}
-};
-
+// A point that cuts the shadow. Lights on entities with a motion follow it.
 struct Light
 {
     glm::vec2 position;
+    float radius = 0.f;     // how far it reaches, 0 lights the whole room
+    bool follow = false;    // position comes from the entity's motion
+    float timer = -1.f;     // seconds until a flash goes out, negative never does
 };
 // Mouse Gestures
 struct MouseGestures
@@ -351,6 +324,9 @@ struct GridMap
 {
     std::vector<std::vector<GridNode>> gridMap;
     std::vector<Entity> exposed_walls;
+    // Merged silhouette of the walls, built with the level and shared by lighting and line of sight
+    std::vector<VisibilitySegment> wall_edges;
+    unsigned int wall_version = 0; // changes whenever wall_edges is rebuilt
     int mapWidth = window_width_px;
     int mapHeight = window_height_px;
     int matrixWidth = 0;
@@ -423,7 +399,8 @@ enum class EFFECT_ASSET_ID
     TEXTURED = 0,
     WATER = TEXTURED + 1,
     LIGHT = WATER + 1,
-    EFFECT_COUNT = LIGHT + 1
+    TEXTURED_INSTANCED = LIGHT + 1,
+    EFFECT_COUNT = TEXTURED_INSTANCED + 1
 };
 const int effect_count = (int)EFFECT_ASSET_ID::EFFECT_COUNT;
 
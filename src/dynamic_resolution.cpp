@@ -0,0 +1,47 @@
+#include "dynamic_resolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float DynamicResolution::SCALE_STEP;
+constexpr float DynamicResolution::HEADROOM;
+constexpr float DynamicResolution::SMOOTHING;
+
+void DynamicResolution::configure(float target_ms, float min_scale, float max_scale)
+{
+    m_targetMs = target_ms;
+    m_minScale = min_scale;
+    m_maxScale = max_scale;
+    reset(m_scale);
+}
+
+void DynamicResolution::reset(float scale)
+{
+    m_scale = std::min(m_maxScale, std::max(m_minScale, scale));
+    m_averageMs = 0.f;
+    m_samples = 0;
+    m_framesSinceAdjust = 0;
+}
+
+float DynamicResolution::update(float frame_ms)
+{
+    m_averageMs = m_samples == 0 ? frame_ms : m_averageMs + (frame_ms - m_averageMs) * SMOOTHING;
+    m_samples++;
+    if (++m_framesSinceAdjust < ADJUST_FRAMES)
+        return m_scale;
+    m_framesSinceAdjust = 0;
+
+    float scale = m_scale;
+    if (m_averageMs > m_targetMs)
+    {
+        // Pixels go with the square of the scale
+        scale = m_scale * std::sqrt(m_targetMs / m_averageMs);
+        scale = std::floor(scale / SCALE_STEP) * SCALE_STEP;
+    }
+    else if (m_averageMs < m_targetMs * HEADROOM)
+    {
+        scale = m_scale + SCALE_STEP;
+    }
+    m_scale = std::min(m_maxScale, std::max(m_minScale, scale));
+    return m_scale;
+}
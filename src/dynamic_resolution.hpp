@@ -0,0 +1,35 @@
+#pragma once
+
+// Picks the render scale that keeps the GPU time of a frame under a target. Frame times
+// are smoothed, and the scale only moves every ADJUST_FRAMES frames so the average can
+// settle at the new scale first. The cost of a frame is taken to grow with the pixel
+// count, so scaling down jumps straight to the estimate, scaling up creeps by SCALE_STEP.
+class DynamicResolution
+{
+public:
+    void configure(float target_ms, float min_scale, float max_scale);
+    void reset(float scale);
+
+    // GPU time of one frame, returns the scale to render the next ones at
+    float update(float frame_ms);
+
+    float scale() const { return m_scale; }
+    float averageMs() const { return m_averageMs; }
+
+    // Scales are kept on multiples of this, small changes are not worth a visible jump
+    static constexpr float SCALE_STEP = 0.05f;
+
+private:
+    static const int ADJUST_FRAMES = 30;
+    // Only scale back up when this far under the target, so it does not bounce back down
+    static constexpr float HEADROOM = 0.8f;
+    static constexpr float SMOOTHING = 0.1f;
+
+    float m_targetMs = 14.f;
+    float m_minScale = 0.5f;
+    float m_maxScale = 1.f;
+    float m_scale = 1.f;
+    float m_averageMs = 0.f;
+    int m_samples = 0;
+    int m_framesSinceAdjust = 0;
+};
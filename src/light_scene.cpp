@@ -0,0 +1,140 @@
+#include "light_scene.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+#include <glm/common.hpp>
+
+bool LightScene::write(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "light_scene 1\n");
+    fprintf(file, "room %.9g %.9g\n", room_size.x, room_size.y);
+    fprintf(file, "occluders %zu %zu\n", occluders.size(), wall_count);
+    for (const VisibilitySegment &s : occluders)
+        fprintf(file, "%.9g %.9g %.9g %.9g\n", s.a.x, s.a.y, s.b.x, s.b.y);
+    fprintf(file, "outlines %zu\n", outlines.size());
+    for (const std::pair<unsigned int, unsigned int> &outline : outlines)
+        fprintf(file, "%u %u\n", outline.first, outline.second);
+    fprintf(file, "lights %zu\n", lights.size());
+    for (const SceneLight &light : lights)
+        fprintf(file, "%.9g %.9g %.9g\n", light.position.x, light.position.y, light.radius);
+    bool ok = fclose(file) == 0;
+    if (!ok)
+        fprintf(stderr, "Failed writing %s\n", path.c_str());
+    return ok;
+}
+
+bool LightScene::read(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+        return false;
+    int version = 0;
+    size_t count = 0;
+    bool ok = fscanf(file, " light_scene %d", &version) == 1 && version == 1 &&
+              fscanf(file, " room %f %f", &room_size.x, &room_size.y) == 2 &&
+              fscanf(file, " occluders %zu %zu", &count, &wall_count) == 2 && wall_count <= count;
+    occluders.resize(ok ? count : 0);
+    for (VisibilitySegment &s : occluders)
+        ok = ok && fscanf(file, "%f %f %f %f", &s.a.x, &s.a.y, &s.b.x, &s.b.y) == 4;
+    ok = ok && fscanf(file, " outlines %zu", &count) == 1;
+    outlines.resize(ok ? count : 0);
+    for (std::pair<unsigned int, unsigned int> &outline : outlines)
+        ok = ok && fscanf(file, "%u %u", &outline.first, &outline.second) == 2 &&
+             outline.first >= wall_count && (size_t)outline.first + outline.second <= occluders.size();
+    ok = ok && fscanf(file, " lights %zu", &count) == 1;
+    lights.resize(ok ? count : 0);
+    for (SceneLight &light : lights)
+        ok = ok && fscanf(file, "%f %f %f", &light.position.x, &light.position.y, &light.radius) == 3;
+    fclose(file);
+    if (!ok)
+        fprintf(stderr, "%s is not a light scene\n", path.c_str());
+    return ok;
+}
+
+bool lightReach(glm::vec2 room_size, const SceneLight &light, glm::vec2 &bounds_min, glm::vec2 &bounds_max)
+{
+    bounds_min = glm::vec2(0.f);
+    bounds_max = room_size;
+    if (light.radius > 0.f)
+    {
+        // The square the light reaches, the sweep needs no more than that
+        bounds_min = glm::max(bounds_min, light.position - light.radius);
+        bounds_max = glm::min(bounds_max, light.position + light.radius);
+    }
+    return bounds_max.x - bounds_min.x >= 1.f && bounds_max.y - bounds_min.y >= 1.f;
+}
+
+// Outlines are convex but mirrored ones wind the other way
+static bool outlineContains(const VisibilitySegment *edges, unsigned int count, glm::vec2 p)
+{
+    bool any_left = false, any_right = false;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        glm::vec2 d = edges[i].b - edges[i].a;
+        glm::vec2 w = p - edges[i].a;
+        float side = d.x * w.y - d.y * w.x;
+        any_left = any_left || side > 0.f;
+        any_right = any_right || side < 0.f;
+    }
+    return !(any_left && any_right);
+}
+
+void gatherLightOccluders(const std::vector<VisibilitySegment> &occluders, size_t wall_count,
+                          const std::vector<std::pair<unsigned int, unsigned int>> &outlines,
+                          glm::vec2 position, glm::vec2 bounds_min, glm::vec2 bounds_max,
+                          std::vector<VisibilitySegment> &out)
+{
+    out.clear();
+    auto consider = [&](const VisibilitySegment &s) {
+        if (std::max(s.a.x, s.b.x) < bounds_min.x || std::min(s.a.x, s.b.x) > bounds_max.x ||
+            std::max(s.a.y, s.b.y) < bounds_min.y || std::min(s.a.y, s.b.y) > bounds_max.y)
+            return;
+        out.push_back(s);
+    };
+    for (size_t i = 0; i < wall_count; i++)
+        consider(occluders[i]);
+    for (const std::pair<unsigned int, unsigned int> &outline : outlines)
+    {
+        if (outlineContains(&occluders[outline.first], outline.second, position))
+            continue;
+        for (unsigned int i = 0; i < outline.second; i++)
+            consider(occluders[outline.first + i]);
+    }
+}
+
+const std::vector<std::vector<glm::vec2>> &LightSceneRenderer::computePolygons(const LightScene &scene)
+{
+    m_polygons.resize(scene.lights.size());
+    for (size_t i = 0; i < scene.lights.size(); i++)
+    {
+        const SceneLight &light = scene.lights[i];
+        glm::vec2 bounds_min, bounds_max;
+        if (!lightReach(scene.room_size, light, bounds_min, bounds_max))
+        {
+            m_polygons[i].clear();
+            continue;
+        }
+        gatherLightOccluders(scene.occluders, scene.wall_count, scene.outlines, light.position,
+                             bounds_min, bounds_max, m_nearby);
+        m_sweep.compute(light.position, m_nearby, bounds_min, bounds_max, m_polygons[i]);
+    }
+    return m_polygons;
+}
+
+void LightSceneRenderer::rasterize(const LightScene &scene, float cell, ShadowMask &mask)
+{
+    computePolygons(scene);
+    m_lit.clear();
+    for (const std::vector<glm::vec2> &polygon : m_polygons)
+        if (polygon.size() >= 3)
+            m_lit.push_back(&polygon);
+    mask.resize((int)(scene.room_size.x / cell), (int)(scene.room_size.y / cell), glm::vec2(0.f), scene.room_size);
+    mask.rasterize(m_lit);
+}
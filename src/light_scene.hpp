@@ -0,0 +1,59 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "shadow_mask.hpp"
+#include "visibility.hpp"
+
+// A point light as the light pass sees it, radius 0 lights the whole room
+struct SceneLight
+{
+    glm::vec2 position;
+    float radius;
+};
+
+// Everything the light pass reads in one frame. F12 saves it next to its shadow mask, the
+// golden image tests replay saved scenes and the light benchmark times them.
+struct LightScene
+{
+    glm::vec2 room_size = glm::vec2(0.f);
+    // The walls first, then each character outline as (first, count)
+    std::vector<VisibilitySegment> occluders;
+    size_t wall_count = 0;
+    std::vector<std::pair<unsigned int, unsigned int>> outlines;
+    std::vector<SceneLight> lights;
+
+    // Plain text, floats written so they read back exactly
+    bool write(const std::string &path) const;
+    bool read(const std::string &path);
+};
+
+// The part of the room a light can reach, false if it is too small to light anything
+bool lightReach(glm::vec2 room_size, const SceneLight &light, glm::vec2 &bounds_min, glm::vec2 &bounds_max);
+
+// Occluders that can shadow a light: the walls and outlines touching its reach. The
+// outline a light is inside is its glow or muzzle flash and casts nothing.
+void gatherLightOccluders(const std::vector<VisibilitySegment> &occluders, size_t wall_count,
+                          const std::vector<std::pair<unsigned int, unsigned int>> &outlines,
+                          glm::vec2 position, glm::vec2 bounds_min, glm::vec2 bounds_max,
+                          std::vector<VisibilitySegment> &out);
+
+// Runs the light pass over a whole scene, with no camera culling or caching
+class LightSceneRenderer
+{
+public:
+    // One polygon per light, empty for lights that reach nothing
+    const std::vector<std::vector<glm::vec2>> &computePolygons(const LightScene &scene);
+    // Shadow mask of the room, one pixel per cell world units
+    void rasterize(const LightScene &scene, float cell, ShadowMask &mask);
+
+private:
+    VisibilitySweep m_sweep;
+    std::vector<VisibilitySegment> m_nearby;
+    std::vector<std::vector<glm::vec2>> m_polygons;
+    std::vector<const std::vector<glm::vec2> *> m_lit;
+};
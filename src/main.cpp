@@ -35,7 +35,7 @@ int main()
     }
 
     // initialize the main systems
-    renderer.init(window);
+    renderer.init(window, ASSET_ARCHIVE_PATH);
     renderer.fontInit(window, PROJECT_SOURCE_DIR + std::string("data/fonts/Kenney_Pixel.ttf"), 35);
     world.init(&renderer);
     aiSystem.init(&renderer);
@@ -56,10 +56,14 @@ int main()
         bool isPaused = world.isPaused();
         if (!isPaused)
         {
+            // Structural changes deferred by a system are applied before the next one runs
             world.step(elapsed_ms);
+            registry.flush_deferred();
             physics.step(elapsed_ms);
             world.handle_collisions(elapsed_ms);
+            registry.flush_deferred();
             aiSystem.step(elapsed_ms);
+            registry.flush_deferred();
         }
 
         renderer.draw(elapsed_ms, isPaused);
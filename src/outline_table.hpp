@@ -0,0 +1,78 @@
+#pragma once
+
+// Character outlines for the light, one per sprite type and animation frame, in sprite
+// space where the sprite spans [-0.5, 0.5]. The points come from svg outlines of each
+// sprite frame; they are stored as the convex hull of those points in winding order so
+// consecutive points are always an edge of the outline.
+
+enum class OUTLINE_ID {
+    PLAYER = 0,
+    MELEE_ENEMY = PLAYER + 1,
+    RANGED_ENEMY = MELEE_ENEMY + 1,
+    BOSS = RANGED_ENEMY + 1,
+    OUTLINE_COUNT = BOSS + 1
+};
+const int outline_count = (int)OUTLINE_ID::OUTLINE_COUNT;
+const int outline_frame_count = 5;
+// Enough for any frame, so callers can transform one into a fixed size buffer
+const int OUTLINE_MAX_POINTS = 16;
+
+struct OutlinePoint
+{
+    float x;
+    float y;
+};
+
+// A run of OUTLINE_POINTS
+struct OutlineFrame
+{
+    unsigned short first;
+    unsigned short count;
+};
+
+constexpr OutlinePoint OUTLINE_POINTS[] = {
+    // playerFrame1
+    {-0.500f, -0.086f}, {-0.342f, -0.463f}, {-0.013f, -0.500f}, {0.500f, 0.035f}, {-0.072f, 0.500f}, {-0.236f, 0.488f}, {-0.372f, 0.383f},
+    // playerFrame2
+    {-0.500f, -0.057f}, {-0.439f, -0.393f}, {-0.305f, -0.484f}, {0.045f, -0.500f}, {0.500f, 0.053f}, {-0.061f, 0.500f}, {-0.240f, 0.500f}, {-0.378f, 0.373f},
+    // playerFrame3
+    {-0.500f, -0.087f}, {-0.312f, -0.500f}, {-0.142f, -0.483f}, {0.500f, 0.006f}, {-0.074f, 0.500f}, {-0.222f, 0.494f}, {-0.369f, 0.384f},
+    // playerFrame4
+    {-0.500f, -0.053f}, {-0.435f, -0.378f}, {-0.289f, -0.484f}, {0.043f, -0.500f}, {0.500f, 0.045f}, {-0.059f, 0.500f}, {-0.245f, 0.480f}, {-0.354f, 0.374f},
+    // playerFrame5
+    {-0.500f, -0.084f}, {-0.295f, -0.500f}, {-0.125f, -0.483f}, {0.500f, 0.011f}, {-0.062f, 0.478f}, {-0.239f, 0.500f}, {-0.375f, 0.337f},
+    // meleeEnemyFrame1
+    {-0.500f, -0.044f}, {-0.424f, -0.301f}, {-0.261f, -0.489f}, {-0.059f, -0.500f}, {0.076f, -0.462f}, {0.340f, -0.335f}, {0.445f, -0.243f}, {0.500f, 0.052f}, {0.282f, 0.489f}, {-0.303f, 0.500f}, {-0.408f, 0.351f},
+    // meleeEnemyFrame2
+    {-0.500f, -0.364f}, {-0.224f, -0.500f}, {-0.025f, -0.492f}, {0.406f, -0.212f}, {0.500f, 0.088f}, {0.218f, 0.500f}, {-0.301f, 0.500f}, {-0.461f, 0.317f},
+    // meleeEnemyFrame3
+    {-0.500f, 0.326f}, {-0.347f, -0.485f}, {0.012f, -0.500f}, {0.431f, -0.239f}, {0.500f, 0.053f}, {0.264f, 0.477f}, {-0.347f, 0.500f},
+    // meleeEnemyFrame4
+    {-0.500f, -0.385f}, {-0.241f, -0.500f}, {-0.040f, -0.496f}, {0.397f, -0.211f}, {0.500f, 0.085f}, {0.218f, 0.492f}, {-0.322f, 0.500f}, {-0.483f, 0.370f},
+    // meleeEnemyFrame5
+    {-0.500f, -0.045f}, {-0.430f, -0.304f}, {-0.251f, -0.492f}, {0.029f, -0.500f}, {0.442f, -0.249f}, {0.500f, 0.076f}, {0.302f, 0.500f}, {-0.282f, 0.496f}, {-0.375f, 0.375f},
+    // rangedEnemyFrame1
+    {-0.500f, 0.301f}, {-0.347f, -0.500f}, {-0.037f, -0.449f}, {0.500f, 0.062f}, {-0.150f, 0.477f}, {-0.359f, 0.500f},
+    // rangedEnemyFrame2
+    {-0.500f, 0.325f}, {-0.329f, -0.500f}, {-0.191f, -0.477f}, {0.500f, 0.048f}, {-0.174f, 0.472f}, {-0.403f, 0.500f},
+    // rangedEnemyFrame4
+    {-0.500f, 0.305f}, {-0.350f, -0.471f}, {-0.188f, -0.500f}, {0.500f, 0.029f}, {-0.176f, 0.477f}, {-0.408f, 0.500f},
+    // rangedEnemyFrame5
+    {-0.500f, 0.494f}, {-0.422f, -0.477f}, {-0.090f, -0.500f}, {0.500f, 0.063f}, {-0.217f, 0.500f},
+    // bossEnemyFrame1
+    {-0.500f, 0.368f}, {-0.378f, -0.500f}, {0.020f, -0.494f}, {0.500f, 0.018f}, {0.268f, 0.362f}, {0.018f, 0.500f}, {-0.246f, 0.496f},
+    // bossEnemyFrame2
+    {-0.500f, 0.369f}, {-0.494f, -0.311f}, {-0.192f, -0.500f}, {0.500f, 0.002f}, {0.273f, 0.338f}, {0.020f, 0.500f}, {-0.247f, 0.498f},
+    // bossEnemyFrame4
+    {-0.500f, 0.368f}, {-0.490f, -0.416f}, {-0.099f, -0.500f}, {0.500f, -0.002f}, {0.274f, 0.346f}, {0.031f, 0.496f}, {-0.235f, 0.500f},
+    // bossEnemyFrame5
+    {-0.500f, 0.360f}, {-0.291f, -0.500f}, {0.042f, -0.482f}, {0.500f, 0.010f}, {0.257f, 0.374f}, {0.032f, 0.490f}, {-0.243f, 0.500f},
+};
+
+// The ranged enemy and the boss reuse their first outline for the third frame
+constexpr OutlineFrame OUTLINE_FRAMES[outline_count][outline_frame_count] = {
+    {{0, 7}, {7, 8}, {15, 7}, {22, 8}, {30, 7}}, // PLAYER
+    {{37, 11}, {48, 8}, {56, 7}, {63, 8}, {71, 9}}, // MELEE_ENEMY
+    {{80, 6}, {86, 6}, {80, 6}, {92, 6}, {98, 5}}, // RANGED_ENEMY
+    {{103, 7}, {110, 7}, {103, 7}, {117, 7}, {124, 7}}, // BOSS
+};
@@ -0,0 +1,150 @@
+#include "render_system.hpp"
+#include "components.hpp"
+
+#include "common.hpp"
+#include "tiny_ecs_registry.hpp"
+#include <map>
+#include <tuple>
+#include <utility>
+
+// Walls never move once a room is generated, so they are baked into world-space
+// vertex buffers of WALL_CHUNK_TILES x WALL_CHUNK_TILES tiles and drawn one chunk per call.
+// The bake runs with the simulation, the render thread uploads what it produced.
+
+void RenderSystem::clearWallChunks()
+{
+    for (StaticChunk &chunk : m_wallChunks) {
+        forgetBuffer(chunk.vbo);
+        forgetBuffer(chunk.ibo);
+        glDeleteBuffers(1, &chunk.vbo);
+        glDeleteBuffers(1, &chunk.ibo);
+    }
+    m_wallChunks.clear();
+    gl_has_errors();
+}
+
+void RenderSystem::bakeWallChunks()
+{
+    const float chunk_size = WALL_CHUNK_TILES * m_roomTileSize.x;
+    // Corners of the sprite quad, same as the SPRITE geometry buffer
+    const vec2 corners[4] = {{-1.f/2, +1.f/2}, {+1.f/2, +1.f/2}, {+1.f/2, -1.f/2}, {-1.f/2, -1.f/2}};
+    const vec2 texcoords[4] = {{0.f, 1.f}, {1.f, 1.f}, {1.f, 0.f}, {0.f, 0.f}};
+    const uint16_t quad_indices[6] = {0, 3, 1, 1, 3, 2};
+
+    // (chunk x, chunk y, texture) -> geometry, ordered so the bake is deterministic
+    std::map<std::tuple<int, int, int>, WallChunkData> chunks;
+
+    for (Entity entity : registry.walls.entities)
+    {
+        if (!registry.wallMotions.has(entity) || !registry.renderRequests.has(entity))
+            continue;
+        const Motion &motion = registry.wallMotions.get(entity);
+        const RenderRequest &render_request = registry.renderRequests.get(entity);
+
+        // Same frame selection as addSprite
+        vec4 uv_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+        if (registry.animations.has(entity)) {
+            uv_rect = frameUV(render_request.used_texture, registry.animations.get(entity));
+        }
+
+        int cx = (int)floor(motion.position.x / chunk_size);
+        int cy = (int)floor(motion.position.y / chunk_size);
+        WallChunkData &chunk = chunks[std::make_tuple(cx, cy, (int)render_request.used_texture)];
+        chunk.texture = render_request.used_texture;
+
+        // Apply the sprite transform on the CPU so the chunk draws with an identity transform
+        const mat3 transform = getSpriteTransform(entity, motion).mat;
+        uint16_t first = (uint16_t)chunk.vertices.size();
+        for (int i = 0; i < 4; i++) {
+            vec3 p = transform * vec3(corners[i], 1.f);
+            TexturedVertex v;
+            v.position = vec3(p.x, p.y, 0.f);
+            v.texcoord = vec2(uv_rect.x, uv_rect.y) + texcoords[i] * vec2(uv_rect.z, uv_rect.w);
+            chunk.vertices.push_back(v);
+            chunk.min = min(chunk.min, vec2(p));
+            chunk.max = max(chunk.max, vec2(p));
+        }
+        for (uint16_t index : quad_indices)
+            chunk.indices.push_back(first + index);
+    }
+
+    m_bakedWallChunks.clear();
+    for (auto &it : chunks)
+        m_bakedWallChunks.push_back(std::move(it.second));
+    m_wallChunksBaked = true;
+}
+
+void RenderSystem::uploadWallChunks(const std::vector<WallChunkData> &chunks)
+{
+    for (const WallChunkData &data : chunks)
+    {
+        StaticChunk chunk;
+        chunk.texture = data.texture;
+        chunk.num_indices = (GLsizei)data.indices.size();
+        chunk.min = data.min;
+        chunk.max = data.max;
+
+        glGenBuffers(1, &chunk.vbo);
+        glGenBuffers(1, &chunk.ibo);
+        bindArrayBuffer(chunk.vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(TexturedVertex) * data.vertices.size(), data.vertices.data(), GL_STATIC_DRAW);
+        bindElementBuffer(chunk.ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * data.indices.size(), data.indices.data(), GL_STATIC_DRAW);
+        gl_has_errors();
+
+        m_wallChunks.push_back(chunk);
+    }
+}
+
+void RenderSystem::drawWallChunks(const RenderFrame &frame)
+{
+    if (m_wallChunks.empty())
+        return;
+
+    const vec2 view_min = frame.view_min;
+    const vec2 view_max = frame.view_max;
+
+    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
+    const EffectLocations &locations = effect_locations[(GLuint)EFFECT_ASSET_ID::TEXTURED];
+    useProgram(program);
+    gl_has_errors();
+
+    GLint in_position_loc = locations.in_position;
+    GLint in_texcoord_loc = locations.in_texcoord;
+    GLint color_uloc = locations.fcolor;
+    GLint transform_loc = locations.transform;
+    GLint projection_loc = locations.projection;
+    GLint uv_rect_uloc = locations.uv_rect;
+
+    // The baked texcoords already point into the atlas
+    const vec3 color = vec3(1);
+    const mat3 identity = mat3(1.f);
+    glUniform4f(uv_rect_uloc, 0.f, 0.f, 1.f, 1.f);
+    glUniform3fv(color_uloc, 1, (float *)&color);
+    glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&identity);
+    glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&frame.camera);
+    glActiveTexture(GL_TEXTURE0);
+    gl_has_errors();
+
+    for (const StaticChunk &chunk : m_wallChunks)
+    {
+        // Skip chunks that do not overlap the camera
+        if (chunk.max.x < view_min.x || chunk.min.x > view_max.x ||
+            chunk.max.y < view_min.y || chunk.min.y > view_max.y) {
+            m_stats.chunks_culled++;
+            continue;
+        }
+        m_stats.chunks_drawn++;
+
+        bindArrayBuffer(chunk.vbo);
+        bindElementBuffer(chunk.ibo);
+        glEnableVertexAttribArray(in_position_loc);
+        glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+        glEnableVertexAttribArray(in_texcoord_loc);
+        glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+
+        bindTexture2D(texture_gl_handles[(GLuint)chunk.texture]);
+        drawElements(GL_TRIANGLES, chunk.num_indices, GL_UNSIGNED_SHORT, nullptr);
+        gl_has_errors();
+    }
+}
@@ -0,0 +1,54 @@
+#include "render_frame.hpp"
+
+#include <cassert>
+
+RenderFrame *RenderFrameQueue::beginRecord()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return m_stopped || m_states[m_nextRecord] == SLOT_STATE::FREE; });
+    if (m_stopped)
+        return nullptr;
+    m_states[m_nextRecord] = SLOT_STATE::RECORDING;
+    return &m_frames[m_nextRecord];
+}
+
+void RenderFrameQueue::publish()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(m_states[m_nextRecord] == SLOT_STATE::RECORDING);
+        m_states[m_nextRecord] = SLOT_STATE::READY;
+        m_nextRecord = 1 - m_nextRecord;
+    }
+    m_changed.notify_all();
+}
+
+RenderFrame *RenderFrameQueue::acquire()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_changed.wait(lock, [this]() { return m_stopped || m_states[m_nextRender] == SLOT_STATE::READY; });
+    if (m_stopped)
+        return nullptr;
+    m_states[m_nextRender] = SLOT_STATE::RENDERING;
+    return &m_frames[m_nextRender];
+}
+
+void RenderFrameQueue::release()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        assert(m_states[m_nextRender] == SLOT_STATE::RENDERING);
+        m_states[m_nextRender] = SLOT_STATE::FREE;
+        m_nextRender = 1 - m_nextRender;
+    }
+    m_changed.notify_all();
+}
+
+void RenderFrameQueue::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopped = true;
+    }
+    m_changed.notify_all();
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "common.hpp"
+#include "components.hpp"
+#include "sprite_batch.hpp"
+#include "visibility.hpp"
+
+// Full screen images, loaded on first use by the screen texture residency manager
+enum class SCREEN_TEXTURE_ID {
+    MAIN_MENU = 0,
+    TUTORIAL = MAIN_MENU + 1,
+    PAUSE_MENU = TUTORIAL + 1,
+    DEATH_SCREEN = PAUSE_MENU + 1,
+    WIN_SCREEN = DEATH_SCREEN + 1,
+    GAME_BACKGROUND = WIN_SCREEN + 1,
+    FLOOR = GAME_BACKGROUND + 1,
+    SPACESHIP = FLOOR + 1,
+    SCREEN_TEXTURE_COUNT = SPACESHIP + 1
+};
+const int screen_texture_count = (int)SCREEN_TEXTURE_ID::SCREEN_TEXTURE_COUNT;
+
+// Resolution the scene is drawn at before the final pass scales it up to the window.
+// DYNAMIC lowers it while the GPU falls behind and raises it again once it catches up.
+enum class RENDER_SCALE_MODE {
+    FULL = 0,
+    HALF = FULL + 1,
+    DYNAMIC = HALF + 1,
+    MODE_COUNT = DYNAMIC + 1
+};
+
+// Screen space, already transformed, so every text of the frame goes in one draw
+struct TextVertex
+{
+    vec2 position;
+    vec2 texcoord;
+    vec3 color;
+};
+
+// One mesh drawn on its own with the textured effect: the room underlay and menu buttons
+struct MeshDraw
+{
+    GEOMETRY_BUFFER_ID geometry;
+    // Atlas page and rect, or a screen texture when texture is 0
+    GLuint texture = 0;
+    SCREEN_TEXTURE_ID screen_texture = SCREEN_TEXTURE_ID::SCREEN_TEXTURE_COUNT;
+    vec4 uv_rect = vec4(0.f, 0.f, 1.f, 1.f);
+    vec3 color = vec3(1.f);
+    mat3 transform = mat3(1.f);
+    mat3 projection = mat3(1.f);
+};
+
+// Walls of one chunk sharing a texture, transformed to world space when the room is baked
+struct WallChunkData
+{
+    TEXTURE_ASSET_ID texture;
+    std::vector<TexturedVertex> vertices;
+    std::vector<uint16_t> indices;
+    vec2 min = vec2(INFINITY);
+    vec2 max = vec2(-INFINITY);
+};
+
+// A light as it was when the frame was recorded
+struct LightInput
+{
+    unsigned int entity;
+    Light light;
+};
+
+// Everything the render thread needs to draw one frame, copied out of the registry by
+// the simulation thread. The render thread never reads the registry.
+struct RenderFrame
+{
+    int active_screen = 0;
+    ivec2 framebuffer_size = {0, 0};
+    ivec2 window_size = {0, 0};
+    float time = 0.f;
+    float darken_screen_factor = -1.f;
+    float light_up = 0.f;
+    bool distort = false;
+    RENDER_SCALE_MODE render_scale_mode = RENDER_SCALE_MODE::FULL;
+
+    // Game screen camera, createCameraMatrix and the world rectangle it shows
+    mat3 camera = mat3(1.f);
+    vec2 view_min = vec2(0.f);
+    vec2 view_max = vec2(0.f);
+
+    // Background, spaceship and floor, then the sprites, the light, and the player on top
+    std::vector<MeshDraw> underlays;
+    SpriteBatchBuilder sprites;
+    SpriteBatchBuilder player;
+    std::vector<MeshDraw> buttons;
+
+    // Light inputs. light_occluders starts with the walls, then each character outline
+    // as (first, count). Regions where an occluder moved are min in xy, max in zw.
+    bool light = false;
+    bool light_walls_changed = false;
+    std::vector<VisibilitySegment> light_occluders;
+    size_t light_wall_count = 0;
+    std::vector<std::pair<unsigned int, unsigned int>> light_outlines;
+    std::vector<vec4> light_dirty_regions;
+    std::vector<LightInput> lights;
+
+    std::vector<vec3> wall_edge_lines; // debug mode only
+    std::vector<TextVertex> text;
+    bool gestures = false;
+    std::vector<vec2> gesture_path;
+
+    // Chunks baked since the last frame replace the uploaded ones
+    bool wall_chunks_changed = false;
+    std::vector<WallChunkData> wall_chunks;
+
+    // Counted while recording, the render thread adds its own counts
+    unsigned int sprites_drawn = 0;
+    unsigned int sprites_culled = 0;
+    unsigned int light_occluders_moved = 0;
+};
+
+// Two frames passed from the simulation thread to the render thread. One is recorded
+// while the other is drawn, so simulating frame N + 1 overlaps drawing frame N.
+// Frames are drawn in order and never dropped, recording waits while both are in use.
+class RenderFrameQueue
+{
+public:
+    // Slot for the next frame, waits until the render thread is done with it.
+    // nullptr once stopped.
+    RenderFrame *beginRecord();
+    // Hands the recorded frame to the render thread
+    void publish();
+
+    // Oldest published frame, waits for one. nullptr once stopped.
+    RenderFrame *acquire();
+    // The acquired frame can be recorded into again
+    void release();
+
+    // Wakes both sides, frames not yet drawn are skipped
+    void stop();
+
+private:
+    enum class SLOT_STATE { FREE, RECORDING, READY, RENDERING };
+
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    RenderFrame m_frames[2];
+    SLOT_STATE m_states[2] = {SLOT_STATE::FREE, SLOT_STATE::FREE};
+    unsigned int m_nextRecord = 0;
+    unsigned int m_nextRender = 0;
+    bool m_stopped = false;
+};
@@ -0,0 +1,123 @@
+#include "render_system.hpp"
+
+// Shadowed GL bindings. The renderer rebinds the same program, buffers and textures
+// for most draws, these skip the ones already bound and count what gets through.
+
+void RenderSystem::invalidateGLState()
+{
+    m_glState.program = GLStateCache::UNKNOWN_BINDING;
+    m_glState.vertex_array = GLStateCache::UNKNOWN_BINDING;
+    m_glState.array_buffer = GLStateCache::UNKNOWN_BINDING;
+    m_glState.element_buffer = GLStateCache::UNKNOWN_BINDING;
+    m_glState.texture_2d = GLStateCache::UNKNOWN_BINDING;
+}
+
+void RenderSystem::useProgram(GLuint program)
+{
+    if (m_glState.program == program) {
+        m_stats.gl_binds_skipped++;
+        return;
+    }
+    glUseProgram(program);
+    m_glState.program = program;
+    m_stats.gl_binds++;
+}
+
+void RenderSystem::bindVertexArray(GLuint vertex_array)
+{
+    if (m_glState.vertex_array == vertex_array) {
+        m_stats.gl_binds_skipped++;
+        return;
+    }
+    glBindVertexArray(vertex_array);
+    m_glState.vertex_array = vertex_array;
+    // The element buffer binding belongs to the vertex array
+    m_glState.element_buffer = GLStateCache::UNKNOWN_BINDING;
+    m_stats.gl_binds++;
+}
+
+void RenderSystem::bindArrayBuffer(GLuint buffer)
+{
+    if (m_glState.array_buffer == buffer) {
+        m_stats.gl_binds_skipped++;
+        return;
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    m_glState.array_buffer = buffer;
+    m_stats.gl_binds++;
+}
+
+void RenderSystem::bindElementBuffer(GLuint buffer)
+{
+    if (m_glState.element_buffer == buffer) {
+        m_stats.gl_binds_skipped++;
+        return;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    m_glState.element_buffer = buffer;
+    m_stats.gl_binds++;
+}
+
+void RenderSystem::bindTexture2D(GLuint texture)
+{
+    // Only texture unit 0 is ever used
+    if (m_glState.texture_2d == texture) {
+        m_stats.gl_binds_skipped++;
+        return;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    m_glState.texture_2d = texture;
+    m_stats.gl_binds++;
+}
+
+void RenderSystem::forgetBuffer(GLuint buffer)
+{
+    if (m_glState.array_buffer == buffer)
+        m_glState.array_buffer = GLStateCache::UNKNOWN_BINDING;
+    if (m_glState.element_buffer == buffer)
+        m_glState.element_buffer = GLStateCache::UNKNOWN_BINDING;
+}
+
+void RenderSystem::forgetTexture(GLuint texture)
+{
+    if (m_glState.texture_2d == texture)
+        m_glState.texture_2d = GLStateCache::UNKNOWN_BINDING;
+}
+
+void RenderSystem::drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices)
+{
+    glDrawElements(mode, count, type, indices);
+    m_stats.draw_calls++;
+}
+
+void RenderSystem::drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instance_count)
+{
+    glDrawElementsInstanced(mode, count, type, indices, instance_count);
+    m_stats.draw_calls++;
+}
+
+void RenderSystem::drawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    glDrawArrays(mode, first, count);
+    m_stats.draw_calls++;
+}
+
+size_t RenderSystem::streamArrayData(const void *data, size_t size)
+{
+    bindArrayBuffer(m_streamVertices.buffer());
+    bool orphaned;
+    size_t offset = m_streamVertices.push(data, size, orphaned);
+    m_stats.stream_bytes += size;
+    m_stats.stream_orphans += orphaned ? 1 : 0;
+    return offset;
+}
+
+size_t RenderSystem::streamElementData(const void *data, size_t size)
+{
+    bindElementBuffer(m_streamIndices.buffer());
+    bool orphaned;
+    size_t offset = m_streamIndices.push(data, size, orphaned);
+    m_stats.stream_bytes += size;
+    m_stats.stream_orphans += orphaned ? 1 : 0;
+    return offset;
+}
@@ -1,12 +1,11 @@
 #include "render_system.hpp"
 #include "components.hpp"
-// Triangulation header only library https://github.com/mapbox/earcut.hpp
-#include "earcut.hpp"
 
 #include "common.hpp"
 #include "tiny_ecs_registry.hpp"
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <cassert>
 #include <cmath>
 #include <cstdint>
 #include <cstdlib>
@@ -20,6 +19,9 @@ void RenderSystem::initLight() {
 
     gl_has_errors();
     glGenVertexArrays(1, &m_light_VAO);
+    // The light fans only change when something near a light moves, so they get their own buffers
+    glGenBuffers(1, &m_lightFanVBO);
+    glGenBuffers(1, &m_lightFanIBO);
     gl_has_errors();
 }
 
@@ -28,24 +30,25 @@ int RenderSystem::getCurrentFrame(Entity& e) {
    return a.current_frame;
 }
 
-std::vector<vec2> RenderSystem::getEntityCurrentVertices(Entity& e) {
-    int currentFrame = getCurrentFrame(e);
-    std::vector<vec2> verts;
-    if (registry.players.has(e)) {
-        verts = playerOutlineVertices[currentFrame];
-    }
-    else if (registry.meleeAttacks.has(e)) {
-        verts = meleeEnemyOutlineVertices[currentFrame];
-    }
-    else if (registry.reloadTimes.has(e)) {
-        verts = rangedEnemyOutlineVertices[currentFrame];
+bool RenderSystem::collectWallSegments(std::vector<VisibilitySegment>& out) {
+    // Only the silhouette extracted with the level, not the four sides of every wall tile
+    unsigned int version = 0;
+    if (registry.gridMaps.size() > 0) {
+        const GridMap& grid = registry.gridMaps.components[0];
+        out.insert(out.end(), grid.wall_edges.begin(), grid.wall_edges.end());
+        version = grid.wall_version;
     }
-    else {
-        verts = bossEnemyOutlineVertices[currentFrame];
-    }
-    std::vector<vec2> updatedVerts;
+    bool changed = version != m_lightWallVersion;
+    m_lightWallVersion = version;
+    return changed;
+}
 
-    Motion& m = registry.motions.get(e);
+void RenderSystem::collectOutlineSegments(Entity& e, OUTLINE_ID outline, RenderFrame& frame) {
+    int currentFrame = getCurrentFrame(e);
+    assert(currentFrame >= 0 && currentFrame < outline_frame_count);
+    const OutlineFrame& outline_frame = OUTLINE_FRAMES[(int)outline][currentFrame];
+
+    Motion& m = getMotion(e);
     Transform t;
     t.translate(m.position);
     if (fabsf(m.angle) < (M_PI/2)) {
@@ -57,264 +60,211 @@ std::vector<vec2> RenderSystem::getEntityCurrentVertices(Entity& e) {
         t.scale(m.scale);
     }
 
-    /* t.scale(m.scale); */
-
-    for (const vec2& v : verts) {
-        vec3 updatedV = t.mat * vec3(v, 1);
-        updatedVerts.push_back({updatedV.x, updatedV.y});
-
-
+    // Points are transformed once into the frame's arena, then joined into edges
+    vec2* points = m_lightArena.allocateArray<vec2>(outline_frame.count);
+    vec2 box_min = vec2(INFINITY), box_max = vec2(-INFINITY);
+    for (int i = 0; i < outline_frame.count; i++) {
+        const OutlinePoint& p = OUTLINE_POINTS[outline_frame.first + i];
+        vec3 transformed = t.mat * vec3(p.x, p.y, 1);
+        points[i] = vec2(transformed.x, transformed.y);
+        box_min = min(box_min, points[i]);
+        box_max = max(box_max, points[i]);
+    }
+    std::vector<VisibilitySegment>& out = frame.light_occluders;
+    frame.light_outlines.push_back({(unsigned int)out.size(), (unsigned int)outline_frame.count});
+    for (int i = 0; i < outline_frame.count; i++) {
+        out.push_back({points[i], points[(i + 1) % outline_frame.count]});
     }
 
-    return updatedVerts;
-}
-
-std::vector<Ray> RenderSystem::generateWallRays() {
-    Light& l = registry.lights.components[0];
-    std::vector<Ray> rays;
-
-    // Wall rays
-    //
-    vec2 innerTopLeftCorner = vec2(window_width_px - 1175, window_height_px - 650);
-    vec2 innerTopRightCorner = vec2(window_width_px - 75, window_height_px - 650);
-    vec2 innerBottomLeftCorner = vec2(window_width_px - 1175, window_height_px - 100);
-    vec2 innerBottomRightCorner = vec2(window_width_px - 75, window_height_px - 100);
-
-    Ray rayTopLeft;
-    rayTopLeft.pos = l.position;
-    rayTopLeft.direction = innerTopLeftCorner - l.position;
-    rays.push_back(rayTopLeft);
-
-    Ray rayTopRight;
-    rayTopRight.pos = l.position;
-    rayTopRight.direction = innerTopRightCorner - l.position;
-    rays.push_back(rayTopRight);
-
-    Ray rayBottomLeft;
-    rayBottomLeft.pos = l.position;
-    rayBottomLeft.direction = innerBottomLeftCorner - l.position;
-    rays.push_back(rayBottomLeft);
-
-    Ray rayBottomRight;
-    rayBottomRight.pos = l.position;
-    rayBottomRight.direction = innerBottomRightCorner - l.position;
-    rays.push_back(rayBottomRight);
-
-    return rays;
-}
-
-std::vector<Ray> RenderSystem::generateRays(std::vector<vec2>& vertices) {
-    // for each ray, generate 2 extra rays to hit walls
-    Light& l = registry.lights.components[0];
-    std::vector<Ray> rays;
-
-    Transform tLeft;
-    Transform tRight;
-    tLeft.rotate(-0.001);
-    tRight.rotate(0.001);
-
-    for (vec2& v : vertices) {
-        Ray r1;
-        r1.pos = l.position;
-        r1.direction = v - r1.pos; 
-        rays.push_back(r1);
-
-        // 2 extra ray for each to hit walls
-        Ray r2;
-        r2.pos = l.position;
-        vec3 r2Dir = tLeft.mat * vec3(r1.direction, 1);
-        r2.direction = {r2Dir.x, r2Dir.y};
-        rays.push_back(r2);
-
-        Ray r3;
-        r3.pos = l.position;
-        vec3 r3Dir = tRight.mat * vec3(r1.direction, 1);
-        r3.direction = {r3Dir.x, r3Dir.y};
-        rays.push_back(r3);
-        }
-
-    return rays;
-}
-
-std::vector<LineSegment> RenderSystem::generateWallSegments() {
-    std::vector<LineSegment> segments;
-    // Wall line segments
-    vec2 innerTopLeftCorner = vec2(window_width_px - 1175, window_height_px - 650);
-    vec2 innerTopRightCorner = vec2(window_width_px - 75, window_height_px - 650);
-    vec2 innerBottomLeftCorner = vec2(window_width_px - 1175, window_height_px - 100);
-    vec2 innerBottomRightCorner = vec2(window_width_px - 75, window_height_px - 100);
-    
-    LineSegment top;
-    top.pos = innerTopLeftCorner;
-    top.direction = innerTopRightCorner - innerTopLeftCorner;
-    top.t = 1;
-    segments.push_back(top);
-
-    LineSegment bot;
-    bot.pos = innerBottomLeftCorner;
-    bot.direction = innerBottomRightCorner - innerBottomLeftCorner;
-    bot.t = 1;
-    segments.push_back(bot);
-
-    LineSegment left;
-    left.pos = innerTopLeftCorner;
-    left.direction = innerBottomLeftCorner - innerTopLeftCorner;
-    left.t = 1;
-    segments.push_back(left);
-
-    LineSegment right;
-    right.pos = innerTopRightCorner;
-    right.direction = innerBottomRightCorner - innerTopRightCorner;
-    right.t = 1;
-    segments.push_back(right);
-
-    return segments;
-}
-
-std::vector<LineSegment> RenderSystem::generateLineSegments(std::vector<vec2>& vertices) {
-    std::vector<LineSegment> segments = generateWallSegments();
-    for (int i = 0; i < (int) vertices.size(); i++) {
-        vec2& currentVert = vertices[i];
-        LineSegment l;
-        if (i == (int) vertices.size() - 1) {
-            l.pos = currentVert;
-            l.direction = vertices[0] - currentVert;
-            l.t = 1;
-
-        }
-        else {
-            l.pos = currentVert;
-            l.direction = vertices[i+1] - currentVert;
-            l.t = 1;
+    // Compare with last frame, both where it was and where it is now may have changed shadows
+    auto found = m_occluderStates.find((unsigned int)e);
+    const bool is_new = found == m_occluderStates.end();
+    OccluderState& state = is_new ? m_occluderStates[(unsigned int)e] : found->second;
+    if (is_new || state.outline != outline || state.frame != currentFrame || state.position != m.position ||
+        state.angle != m.angle || state.scale != m.scale) {
+        if (!is_new) {
+            frame.light_dirty_regions.push_back(vec4(state.box_min, state.box_max));
         }
-
-        segments.push_back(l);
-
+        frame.light_dirty_regions.push_back(vec4(box_min, box_max));
+        state.outline = outline;
+        state.frame = currentFrame;
+        state.position = m.position;
+        state.angle = m.angle;
+        state.scale = m.scale;
+        state.box_min = box_min;
+        state.box_max = box_max;
+        frame.light_occluders_moved++;
     }
-    return segments;
+    state.seen = m_occluderFrame;
 }
 
-float RenderSystem::getRayIntersectionDist(Ray& ray, LineSegment& segment) {
-
-    // Confirm ray and segment aren't parallel
-    // -1 means does not intersect
-    vec2 normalizedRayDir = normalize(ray.direction);
-    vec2 normalizedSegmentDir = normalize(segment.direction);
-    if (normalizedRayDir == normalizedSegmentDir || 
-            normalizedRayDir == -normalizedSegmentDir) {
-        return -9999.f;
-    }
-
-    float T2 = (ray.direction.x * (segment.pos.y - ray.pos.y) + ray.direction.y * (ray.pos.x - segment.pos.x)) / (segment.direction.x * ray.direction.y - segment.direction.y* ray.direction.x);
-
-    float T1 = (segment.pos.x + segment.direction.x * T2 - ray.pos.x) / ray.direction.x;
-
-    /* if ((T1 > 0) && ((0 < T2) && (T2 < 1))) { */
-    if ((T1 > 0) && ((0 <= T2) && (T2 <= 1))) {
-        return T1;
-    }
-    else {
-        return -9999.f;
+bool RenderSystem::lightBounds(const Light& light, vec2 view_min, vec2 view_max, vec2& bounds_min, vec2& bounds_max) {
+    const vec2 room_size = m_roomTileDimensions * m_roomTileSize;
+    if (!lightReach(room_size, {light.position, light.radius}, bounds_min, bounds_max)) {
+        return false;
     }
+    return bounds_max.x > view_min.x && bounds_min.x < view_max.x &&
+           bounds_max.y > view_min.y && bounds_min.y < view_max.y;
 }
 
-std::vector<std::array<float, 2>> RenderSystem::getLitArea(std::vector<Ray>& rays, std::vector<LineSegment>& segments) {
-    std::vector<std::pair<vec2, float>> visibilityPolygon;
-    for (Ray& r: rays) {
-        LineSegment closestSegment;
-        float closestDist = 5000.f;
-        for (LineSegment& l : segments) {
-            float dist = getRayIntersectionDist(r, l);
-
-            if (dist > 0.f && dist < closestDist) {
-                closestSegment = l;
-                closestDist = dist;
-            }
+bool RenderSystem::lightNeedsUpdate(const LightCache& cache, const Light& light, vec2 bounds_min, vec2 bounds_max,
+                                    const std::vector<vec4>& dirty_regions) const {
+    if (cache.frame == 0 || cache.position != light.position ||
+        cache.bounds_min != bounds_min || cache.bounds_max != bounds_max) {
+        return true;
+    }
+    for (const vec4& region : dirty_regions) {
+        if (region.z >= bounds_min.x && region.x <= bounds_max.x &&
+            region.w >= bounds_min.y && region.y <= bounds_max.y) {
+            return true;
         }
-        vec2 intersectionPoint = r.pos + r.direction * vec2(closestDist,closestDist);
-        float angle = atan2(r.direction.y, r.direction.x);
-        std::pair<vec2, float> p = {intersectionPoint, angle};
-        visibilityPolygon.push_back(p);
     }
+    return false;
+}
 
-    // Sort by angle to connect clockwise
-    std::sort(visibilityPolygon.begin(), visibilityPolygon.end(),
-            [] (std::pair<vec2, float>& a, std::pair<vec2, float>& b) {
-                return a.second < b.second;
-            });
-    
-    std::vector<std::array<float, 2>> normalizedVertexOnlyPolygon;
-    for (std::pair<vec2, float>& p : visibilityPolygon) {
-        std::array<float, 2> point = {p.first.x, p.first.y};
-        normalizedVertexOnlyPolygon.push_back(point);
-    }
-    
-    return normalizedVertexOnlyPolygon;
+void RenderSystem::computeLightPolygon(LightCache& cache, const Light& light, vec2 bounds_min, vec2 bounds_max,
+                                       const RenderFrame& frame) {
+    // Only occluders touching the light's square can change its polygon
+    gatherLightOccluders(frame.light_occluders, frame.light_wall_count, frame.light_outlines, light.position,
+                         bounds_min, bounds_max, m_lightNearby);
+    m_visibility.compute(light.position, m_lightNearby, bounds_min, bounds_max, cache.polygon);
+    cache.position = light.position;
+    cache.bounds_min = bounds_min;
+    cache.bounds_max = bounds_max;
+    m_stats.lights_computed++;
 }
 
-void RenderSystem::lightScreen() {
-    std::vector<Ray> rays = generateWallRays();
-    std::vector<LineSegment> segments = generateWallSegments();
+void RenderSystem::recordLight(RenderFrame& frame) {
+    m_occluderFrame++;
+    m_lightArena.reset();
+    frame.light = true;
+    frame.light_occluders.clear();
+    frame.light_outlines.clear();
+    frame.light_dirty_regions.clear();
+    frame.lights.clear();
+    frame.light_walls_changed = collectWallSegments(frame.light_occluders);
+    frame.light_wall_count = frame.light_occluders.size();
 
     for (Entity& e : registry.players.entities) {
-        std::vector<vec2> vertices = getEntityCurrentVertices(e); 
-        std::vector<Ray> entityRays = generateRays(vertices);
-        std::vector<LineSegment> entitySegments = generateLineSegments(vertices);
-        rays.insert(rays.end(), entityRays.begin(), entityRays.end());
-        segments.insert(segments.end(), entitySegments.begin(), entitySegments.end());
+        collectOutlineSegments(e, OUTLINE_ID::PLAYER, frame);
     }
     for (Entity& e : registry.meleeAttacks.entities) {
         if (registry.bosses.has(e)) {
             continue;
         }
-        std::vector<vec2> vertices = getEntityCurrentVertices(e); 
-        std::vector<Ray> entityRays = generateRays(vertices);
-        std::vector<LineSegment> entitySegments = generateLineSegments(vertices);
-
-        rays.insert(rays.end(), entityRays.begin(), entityRays.end());
-        segments.insert(segments.end(), entitySegments.begin(), entitySegments.end());
+        collectOutlineSegments(e, OUTLINE_ID::MELEE_ENEMY, frame);
     }
-
     for (Entity& e : registry.reloadTimes.entities) {
         if (registry.bosses.has(e)) {
             continue;
         }
-        std::vector<vec2> vertices = getEntityCurrentVertices(e); 
-        std::vector<Ray> entityRays = generateRays(vertices);
-        std::vector<LineSegment> entitySegments = generateLineSegments(vertices);
-
-        rays.insert(rays.end(), entityRays.begin(), entityRays.end());
-        segments.insert(segments.end(), entitySegments.begin(), entitySegments.end());
+        collectOutlineSegments(e, OUTLINE_ID::RANGED_ENEMY, frame);
     }
-
     for (Entity& e : registry.bosses.entities) {
         // if boss is actively teleporting, don't render
         EnemyState& enemyState = registry.enemies.get(e).enemyState;
         if (enemyState == EnemyState::TELEPORTING) {
             continue;
         }
+        collectOutlineSegments(e, OUTLINE_ID::BOSS, frame);
+    }
+
+    // Characters that are gone leave light where their shadow was
+    for (auto it = m_occluderStates.begin(); it != m_occluderStates.end();) {
+        if (it->second.seen != m_occluderFrame) {
+            frame.light_dirty_regions.push_back(vec4(it->second.box_min, it->second.box_max));
+            it = m_occluderStates.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
 
-        std::vector<vec2> vertices = getEntityCurrentVertices(e); 
-        std::vector<Ray> entityRays = generateRays(vertices);
-        std::vector<LineSegment> entitySegments = generateLineSegments(vertices);
+    for (unsigned int i = 0; i < registry.lights.size(); i++) {
+        Entity e = registry.lights.entities[i];
+        Light& light = registry.lights.components[i];
+        if (light.follow) {
+            light.position = getMotion(e).position;
+        }
+        frame.lights.push_back({(unsigned int)e, light});
+    }
 
-        rays.insert(rays.end(), entityRays.begin(), entityRays.end());
-        segments.insert(segments.end(), entitySegments.begin(), entitySegments.end());
+    if (!m_lightScenePath.empty()) {
+        writeLightScene(frame);
+        m_lightScenePath.clear();
     }
-    std::vector<std::vector<std::array<float, 2>>> lightPolygonContainer;
-    std::vector<std::array<float, 2>> lightPolygon = getLitArea(rays, segments);
-    lightPolygonContainer.push_back(lightPolygon);
-    
-    std::vector<uint16_t> indices = mapbox::earcut<uint16_t>(lightPolygonContainer);
-    // Convert to vec2 again
-    std::vector<vec3> lightVectorPolygon;
-    for (std::array<float,2>& p : lightPolygon) {
-        lightVectorPolygon.push_back(vec3(p[0], p[1], 1.0f));
+}
+
+void RenderSystem::lightScreen(const RenderFrame& frame) {
+    m_lightFrame++;
+    const mat3& projection = frame.camera;
+
+    // Only lights reaching into the camera cost anything, and only those something moved near are swept again
+    std::swap(m_lightsDrawn, m_lightsDrawnBefore);
+    m_lightsDrawn.clear();
+    bool fans_changed = false;
+    for (const LightInput& input : frame.lights) {
+        const Light& light = input.light;
+        vec2 bounds_min, bounds_max;
+        if (!lightBounds(light, frame.view_min, frame.view_max, bounds_min, bounds_max)) {
+            m_stats.lights_culled++;
+            continue;
+        }
+        LightCache& cache = m_lightCache[input.entity];
+        if (frame.light_walls_changed || lightNeedsUpdate(cache, light, bounds_min, bounds_max, frame.light_dirty_regions)) {
+            computeLightPolygon(cache, light, bounds_min, bounds_max, frame);
+            fans_changed = true;
+        }
+        cache.frame = m_lightFrame;
+        if (cache.polygon.size() < 3) {
+            continue;
+        }
+        m_lightsDrawn.push_back(input.entity);
+        m_stats.lights_drawn++;
     }
+    fans_changed = fans_changed || m_lightsDrawn != m_lightsDrawnBefore;
 
-    glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::LIGHT]);
-    glBindVertexArray(m_light_VAO);
-    bindVBOandIBO(GEOMETRY_BUFFER_ID::VISIBILITY_POLYGON, lightVectorPolygon, indices);
+    // Lights that went away or out of view
+    for (auto it = m_lightCache.begin(); it != m_lightCache.end();) {
+        if (it->second.frame != m_lightFrame) {
+            it = m_lightCache.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+
+    useProgram(effects[(GLuint)EFFECT_ASSET_ID::LIGHT]);
+    bindVertexArray(m_light_VAO);
+    bindArrayBuffer(m_lightFanVBO);
+    bindElementBuffer(m_lightFanIBO);
+    if (fans_changed) {
+        // Each polygon is star shaped around its light, so it is drawn as a fan from it
+        std::vector<vec3>& lightVectorPolygon = m_lightFanVertices;
+        std::vector<uint16_t>& indices = m_lightFanIndices;
+        lightVectorPolygon.clear();
+        indices.clear();
+        for (size_t i = 0; i < m_lightsDrawn.size(); i++) {
+            const LightCache& cache = m_lightCache[m_lightsDrawn[i]];
+            const std::vector<vec2>& polygon = cache.polygon;
+            if (lightVectorPolygon.size() + polygon.size() + 1 > UINT16_MAX) {
+                break;
+            }
+            const uint16_t center = (uint16_t)lightVectorPolygon.size();
+            lightVectorPolygon.push_back(vec3(clamp(cache.position, cache.bounds_min + 0.5f, cache.bounds_max - 0.5f), 1.0f));
+            for (const vec2& p : polygon) {
+                lightVectorPolygon.push_back(vec3(p, 1.0f));
+            }
+            const uint16_t count = (uint16_t)polygon.size();
+            for (uint16_t j = 1; j <= count; j++) {
+                indices.push_back(center);
+                indices.push_back(center + j);
+                indices.push_back(center + (j == count ? 1 : j + 1));
+            }
+        }
+        glBufferData(GL_ARRAY_BUFFER, sizeof(vec3) * lightVectorPolygon.size(), lightVectorPolygon.data(), GL_DYNAMIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(uint16_t) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
+    }
 
     glStencilMask(0xFF);
     glClearStencil(0);
@@ -328,19 +278,20 @@ void RenderSystem::lightScreen() {
     gl_has_errors();
 
     // Draw everything in visibility polygon normally
-	const GLuint light_program = effects[(GLuint)EFFECT_ASSET_ID::LIGHT];
-	GLint in_position_loc = glGetAttribLocation(light_program, "in_position");
+	const EffectLocations &light_locations = effect_locations[(GLuint)EFFECT_ASSET_ID::LIGHT];
+	GLint in_position_loc = light_locations.in_position;
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
 
-    mat3 projection = createProjectionMatrix();
-	GLuint projection_loc = glGetUniformLocation(light_program, "projection");
+	GLuint projection_loc = light_locations.projection;
 	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
 
-	GLuint shadow_on_loc = glGetUniformLocation(light_program, "shadow_on");
+	GLuint shadow_on_loc = light_locations.shadow_on;
     glUniform1f(shadow_on_loc, 0.f);
 
-    glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_SHORT, nullptr);
+    if (!m_lightFanIndices.empty()) {
+        drawElements(GL_TRIANGLES, (GLsizei)m_lightFanIndices.size(), GL_UNSIGNED_SHORT, nullptr);
+    }
 
     // Now draw shadow
     glStencilMask(0x00);
@@ -349,31 +300,74 @@ void RenderSystem::lightScreen() {
     glStencilMask(0x00);
     glUniform1f(shadow_on_loc, 1.0f);
 
-    vec2 innerTopLeftCorner = vec2(window_width_px - 1175, window_height_px - 650);
-    vec2 innerTopRightCorner = vec2(window_width_px - 75, window_height_px - 650);
-    vec2 innerBottomLeftCorner = vec2(window_width_px - 1175, window_height_px - 100);
-    vec2 innerBottomRightCorner = vec2(window_width_px - 75, window_height_px - 100);
-
-	std::vector<vec3> shadow_vertices(4);
-    shadow_vertices[0] = { innerTopLeftCorner, 1.0f }; // Top-left
-    shadow_vertices[1] = { innerTopRightCorner, 1.0f }; // Top-right
-    shadow_vertices[2] = {  innerBottomRightCorner, 1.0f }; // Bottom-right
-    shadow_vertices[3] = { innerBottomLeftCorner, 1.0f }; // Bottom-left
-
-	const std::vector<uint16_t> shadow_indices = { 0, 1, 2, 0, 2, 3};
-
-    bindVBOandIBO(GEOMETRY_BUFFER_ID::SHADOW_PLANE, 
-            shadow_vertices,
-            shadow_indices);
-
+    // The shadow plane covers the room and never changes, it was uploaded at init
+    bindArrayBuffer(vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SHADOW_PLANE]);
+    bindElementBuffer(index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SHADOW_PLANE]);
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
 
 	gl_has_errors();
-    glDrawElements(GL_TRIANGLES, (GLsizei) shadow_indices.size(), GL_UNSIGNED_SHORT, nullptr);
+    drawElements(GL_TRIANGLES, (GLsizei)meshes[(GLuint)GEOMETRY_BUFFER_ID::SHADOW_PLANE].num_indices, GL_UNSIGNED_SHORT, nullptr);
     glDisable(GL_STENCIL_TEST);
     /* gl_has_errors(); */
+}
+
+bool RenderSystem::saveLightScene(const std::string& path) {
+    if (!LIGHT_SYSTEM_TOGGLE) {
+        fprintf(stderr, "The light system is off, there is no light scene to save\n");
+        return false;
+    }
+    m_lightScenePath = path;
+    return true;
+}
 
+// Runs on the simulation thread with the frame just recorded, the mask needs no GL
+void RenderSystem::writeLightScene(const RenderFrame& frame) {
+    LightScene scene;
+    scene.room_size = m_roomTileDimensions * m_roomTileSize;
+    scene.occluders = frame.light_occluders;
+    scene.wall_count = frame.light_wall_count;
+    scene.outlines = frame.light_outlines;
+    for (const LightInput& input : frame.lights) {
+        scene.lights.push_back({input.light.position, input.light.radius});
+    }
+
+    LightSceneRenderer scene_renderer;
+    ShadowMask mask;
+    scene_renderer.rasterize(scene, SHADOW_MASK_CELL, mask);
+    if (scene.write(m_lightScenePath + ".scene") && mask.writePGM(m_lightScenePath + ".pgm")) {
+        printf("Saved the light scene and its shadow mask to %s.scene and .pgm\n", m_lightScenePath.c_str());
+    }
+}
+
+void RenderSystem::recordWallEdges(RenderFrame& frame) {
+    if (registry.gridMaps.size() == 0) {
+        return;
+    }
+    const std::vector<VisibilitySegment>& edges = registry.gridMaps.components[0].wall_edges;
+    std::vector<vec3>& lines = frame.wall_edge_lines;
+    lines.reserve(edges.size() * 2);
+    for (const VisibilitySegment& edge : edges) {
+        lines.push_back(vec3(edge.a, 1.0f));
+        lines.push_back(vec3(edge.b, 1.0f));
+    }
+}
+
+void RenderSystem::drawWallEdges(const RenderFrame& frame) {
+    const std::vector<vec3>& lines = frame.wall_edge_lines;
+    const mat3& projection = frame.camera;
+
+    // The light shader's shadow colour is enough to see the outline over the walls
+    useProgram(effects[(GLuint)EFFECT_ASSET_ID::LIGHT]);
+    bindVertexArray(vao);
+    const EffectLocations& light_locations = effect_locations[(GLuint)EFFECT_ASSET_ID::LIGHT];
+    const size_t offset = streamArrayData(lines.data(), sizeof(vec3) * lines.size());
+    glEnableVertexAttribArray(light_locations.in_position);
+    glVertexAttribPointer(light_locations.in_position, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)offset);
+    glUniformMatrix3fv(light_locations.projection, 1, GL_FALSE, (float*)&projection);
+    glUniform1f(light_locations.shadow_on, 1.0f);
+    drawArrays(GL_LINES, 0, (GLsizei)lines.size());
+    gl_has_errors();
 }
 
 
@@ -0,0 +1,64 @@
+#include "render_system.hpp"
+
+#include <algorithm>
+
+// The scene can be drawn below the window resolution and stretched by the final pass,
+// either at a fixed scale or at one picked each frame to hold DYNAMIC_RESOLUTION_TARGET_MS.
+
+void RenderSystem::applyRenderScale(const RenderFrame &frame)
+{
+    if (frame.render_scale_mode != m_appliedScaleMode) {
+        // Dynamic starts from wherever the scale is now
+        if (frame.render_scale_mode == RENDER_SCALE_MODE::DYNAMIC) {
+            m_dynamicResolution.reset(m_renderScale);
+        }
+        m_appliedScaleMode = frame.render_scale_mode;
+    }
+
+    switch (m_appliedScaleMode) {
+    case RENDER_SCALE_MODE::HALF:
+        m_renderScale = 0.5f;
+        break;
+    case RENDER_SCALE_MODE::DYNAMIC:
+        m_renderScale = m_dynamicResolution.scale();
+        break;
+    default:
+        m_renderScale = 1.f;
+        break;
+    }
+
+    // The screen texture was made at the framebuffer size and the window does not resize
+    const ivec2 full = min(frame.framebuffer_size, m_screenTextureSize);
+    m_sceneSize = max(ivec2(1), ivec2(vec2(full) * m_renderScale + 0.5f));
+}
+
+bool RenderSystem::beginFrameTimer()
+{
+    const int slot = m_frameTimer;
+    const GLuint query = m_frameTimerQueries[slot];
+    if (m_frameTimerPending[slot]) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            // The GPU is more than FRAME_TIMER_QUERIES frames behind, this frame goes untimed
+            return false;
+        }
+        GLuint64 elapsed_ns = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed_ns);
+        m_frameTimerPending[slot] = false;
+        m_gpuFrameMs = (float)(elapsed_ns / 1e6);
+        if (m_appliedScaleMode == RENDER_SCALE_MODE::DYNAMIC) {
+            m_dynamicResolution.update(m_gpuFrameMs);
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+    return true;
+}
+
+void RenderSystem::endFrameTimer()
+{
+    glEndQuery(GL_TIME_ELAPSED);
+    m_frameTimerPending[m_frameTimer] = true;
+    m_frameTimer = (m_frameTimer + 1) % FRAME_TIMER_QUERIES;
+    gl_has_errors();
+}
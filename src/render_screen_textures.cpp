@@ -0,0 +1,158 @@
+#include "render_system.hpp"
+#include "components.hpp"
+
+#include <chrono>
+
+// Menu and background images are large and most of them are rarely seen, so they are
+// only decoded and uploaded when a screen first draws them. Screens that usually come
+// next are decoded ahead on the load pool, and the least recently drawn textures are
+// dropped whenever the resident total goes over m_screenTextureBudget.
+
+void RenderSystem::initScreenTextures()
+{
+    const std::array<std::string, screen_texture_count> paths = {
+        mainMenuImgPath, tutorialImgPath, pauseMenuImgPath, deathScreenImgPath,
+        winScreenImgPath, gameBackgroundImgPath, floorImgPath, spaceshipImgPath};
+    for (int i = 0; i < screen_texture_count; i++)
+        m_screenTextures[i].path = paths[i];
+
+    // Pixel art backgrounds stay sharp, the floor tiles across the room
+    m_screenTextures[(int)SCREEN_TEXTURE_ID::GAME_BACKGROUND].filter = GL_NEAREST;
+    m_screenTextures[(int)SCREEN_TEXTURE_ID::SPACESHIP].filter = GL_NEAREST;
+    m_screenTextures[(int)SCREEN_TEXTURE_ID::FLOOR].filter = GL_NEAREST;
+    m_screenTextures[(int)SCREEN_TEXTURE_ID::FLOOR].repeat = true;
+
+    // The game always opens on the main menu
+    prefetchScreenTexture(SCREEN_TEXTURE_ID::MAIN_MENU);
+}
+
+void RenderSystem::prefetchScreenTexture(SCREEN_TEXTURE_ID id)
+{
+    ScreenTexture &screen = m_screenTextures[(int)id];
+    if (screen.handle != 0 || screen.pending.valid())
+        return;
+    const std::string path = screen.path;
+    screen.pending = m_loadPool->submit([this, path]() { return decodeImagePixels(path); });
+}
+
+void RenderSystem::prefetchLikelyScreens(int active_screen)
+{
+    switch ((SCREEN_ID)active_screen)
+    {
+    case SCREEN_ID::MAIN_MENU:
+    case SCREEN_ID::TUTORIAL_SCREEN:
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::TUTORIAL);
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::GAME_BACKGROUND);
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::SPACESHIP);
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::FLOOR);
+        break;
+    case SCREEN_ID::GAME_SCREEN:
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::PAUSE_MENU);
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::DEATH_SCREEN);
+        break;
+    case SCREEN_ID::PAUSE_SCREEN:
+    case SCREEN_ID::DEATH_SCREEN:
+    case SCREEN_ID::WIN_SCREEN:
+        prefetchScreenTexture(SCREEN_TEXTURE_ID::MAIN_MENU);
+        break;
+    default:
+        break;
+    }
+}
+
+GLuint RenderSystem::acquireScreenTexture(SCREEN_TEXTURE_ID id)
+{
+    ScreenTexture &screen = m_screenTextures[(int)id];
+    screen.last_used_frame = m_screenFrame;
+    if (screen.handle != 0)
+        return screen.handle;
+
+    // Not resident: take the prefetched pixels, or decode here if nobody asked ahead
+    auto start = std::chrono::high_resolution_clock::now();
+    ImagePixels image;
+    if (screen.pending.valid())
+        image = screen.pending.get();
+    else
+        image = decodeImagePixels(screen.path);
+    if (image.data == nullptr)
+    {
+        const std::string message = "Could not load the file " + screen.path + ".";
+        fprintf(stderr, "%s", message.c_str());
+        assert(false);
+        return 0;
+    }
+
+    glGenTextures(1, &screen.handle);
+    bindTexture2D(screen.handle);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.size.x, image.size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data);
+    if (screen.repeat)
+    {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, screen.filter);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, screen.filter);
+    gl_has_errors();
+
+    screen.bytes = (size_t)image.size.x * image.size.y * 4;
+    m_screenTextureBytes += screen.bytes;
+    freeImagePixels(image);
+
+    float load_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("Loaded %s in %.1f ms, %.1f MB of screen textures resident\n",
+           screen.path.c_str(), load_ms, m_screenTextureBytes / (1024.f * 1024.f));
+
+    evictScreenTextures();
+    return screen.handle;
+}
+
+void RenderSystem::setScreenTextureBudget(size_t bytes)
+{
+    m_screenTextureBudget = bytes;
+    evictScreenTextures();
+}
+
+void RenderSystem::evictScreenTextures()
+{
+    while (m_screenTextureBytes > m_screenTextureBudget)
+    {
+        // Anything drawn this frame is still needed, even if that leaves us over budget
+        ScreenTexture *oldest = nullptr;
+        for (ScreenTexture &screen : m_screenTextures)
+        {
+            if (screen.handle == 0 || screen.last_used_frame == m_screenFrame)
+                continue;
+            if (oldest == nullptr || screen.last_used_frame < oldest->last_used_frame)
+                oldest = &screen;
+        }
+        if (oldest == nullptr)
+            return;
+
+        forgetTexture(oldest->handle);
+        glDeleteTextures(1, &oldest->handle);
+        oldest->handle = 0;
+        m_screenTextureBytes -= oldest->bytes;
+        oldest->bytes = 0;
+    }
+}
+
+void RenderSystem::clearScreenTextures()
+{
+    for (ScreenTexture &screen : m_screenTextures)
+    {
+        if (screen.pending.valid())
+        {
+            ImagePixels image = screen.pending.get();
+            freeImagePixels(image);
+        }
+        if (screen.handle != 0)
+        {
+            forgetTexture(screen.handle);
+            glDeleteTextures(1, &screen.handle);
+        }
+        screen.handle = 0;
+        screen.bytes = 0;
+    }
+    m_screenTextureBytes = 0;
+    gl_has_errors();
+}
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 #include <SDL.h>
 #include <cmath>
+#include <cstddef>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -16,148 +17,171 @@
 
 extern DistortToggle toggle;
 
-void RenderSystem::renderTextBulk(std::vector<TextRenderRequest>& requests)
+const TextLayout& RenderSystem::getTextLayout(const std::string& text, float scale)
 {
-    glUseProgram(m_font_shaderProgram);
-    glBindVertexArray(m_font_VAO);
+    auto key = std::make_pair(text, scale);
+    auto cached = m_textLayouts.find(key);
+    if (cached != m_textLayouts.end())
+        return cached->second;
 
-    for (const auto& request : requests)
+    if (m_textLayouts.size() >= TEXT_LAYOUT_CACHE_LIMIT)
     {
-        GLint textColor_location = glGetUniformLocation(m_font_shaderProgram, "textColor");
-        glUniform3f(textColor_location, request.color.x, request.color.y, request.color.z);
-
-        GLint transformLoc = glGetUniformLocation(m_font_shaderProgram, "transform");
-        glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(request.transform));
-
-        float currentX = request.x;
-        
-        for (const char c : request.text)
-        {
-            Character ch = m_ftCharacters[c];
-
-            float xpos = currentX + ch.Bearing.x * request.scale;
-            float ypos = request.y - (ch.Size.y - ch.Bearing.y) * request.scale;
+        m_textLayouts.clear();
+        m_textLayoutGeneration++;
+    }
 
-            float w = ch.Size.x * request.scale;
-            float h = ch.Size.y * request.scale;
+    TextLayout& layout = m_textLayouts[key];
+    layout.vertices.reserve(text.size() * 6);
+    float currentX = 0.f;
+    for (const char c : text)
+    {
+        unsigned int code = (unsigned char)c;
+        if (code >= m_ftCharacters.size())
+            continue;
+        const Character& ch = m_ftCharacters[code];
+
+        float xpos = currentX + ch.Bearing.x * scale;
+        float ypos = -(ch.Size.y - ch.Bearing.y) * scale;
+
+        float w = ch.Size.x * scale;
+        float h = ch.Size.y * scale;
+
+        // Glyph rows are stored top down, so the top of the quad takes the lower v
+        const vec4& uv = ch.uv_rect;
+        const vec4 corners[4] = {
+            { xpos,     ypos + h,   uv.x,        uv.y        },
+            { xpos,     ypos,       uv.x,        uv.y + uv.w },
+            { xpos + w, ypos,       uv.x + uv.z, uv.y + uv.w },
+            { xpos + w, ypos + h,   uv.x + uv.z, uv.y        }
+        };
+        const int quad[6] = { 0, 1, 2, 0, 2, 3 };
+        for (int corner : quad)
+            layout.vertices.push_back(corners[corner]);
+
+        currentX += (ch.Advance >> 6) * scale;
+    }
+    return layout;
+}
 
-            float vertices[6][4] = {
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos,     ypos,       0.0f, 1.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
+const TextLayout& RenderSystem::resolveTextLayout(Text& text)
+{
+    if (text.dirty || text.layout == nullptr || text.layout_generation != m_textLayoutGeneration)
+    {
+        text.layout = &getTextLayout(text.text, text.scale);
+        text.layout_generation = m_textLayoutGeneration;
+        text.dirty = false;
+    }
+    return *text.layout;
+}
 
-                { xpos,     ypos + h,   0.0f, 0.0f },
-                { xpos + w, ypos,       1.0f, 1.0f },
-                { xpos + w, ypos + h,   1.0f, 0.0f }
-            };
+void RenderSystem::appendText(const TextLayout& layout, vec2 origin, vec3 color, const glm::mat4& transform,
+                              std::vector<TextVertex>& out)
+{
+    for (const vec4& vertex : layout.vertices)
+    {
+        glm::vec4 position = transform * glm::vec4(origin.x + vertex.x, origin.y + vertex.y, 0.f, 1.f);
+        out.push_back({ vec2(position) / position.w, vec2(vertex.z, vertex.w), color });
+    }
+}
 
-            glBindTexture(GL_TEXTURE_2D, ch.TextureID);
+void RenderSystem::recordTexts(RenderFrame& frame)
+{
+    const glm::mat4 identity(1.f);
+    const float screen_height = (float)frame.window_size.y;
+    for (uint i = 0; i < registry.texts.size(); i++)
+    {
+        Text& text = registry.texts.components[i];
+        appendText(resolveTextLayout(text), vec2(text.position.x, screen_height - text.position.y), text.color, identity, frame.text);
+    }
+}
 
-            glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-            glBindBuffer(GL_ARRAY_BUFFER, 0);
+void RenderSystem::flushText(const std::vector<TextVertex>& vertices)
+{
+    if (vertices.empty())
+        return;
 
-            glDrawArrays(GL_TRIANGLES, 0, 6);
+    useProgram(m_font_shaderProgram);
+    bindVertexArray(m_font_VAO);
+    glActiveTexture(GL_TEXTURE0);
+    bindTexture2D(m_font_atlas);
 
-            currentX += (ch.Advance >> 6) * request.scale;
-        }
-    }
+    const size_t base = streamArrayData(vertices.data(), sizeof(TextVertex) * vertices.size());
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)base);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void *)(base + offsetof(TextVertex, color)));
+    drawArrays(GL_TRIANGLES, 0, (GLsizei)vertices.size());
 
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    bindVertexArray(0);
+    bindTexture2D(0);
+    gl_has_errors();
 }
 
 void RenderSystem::updateAnimations(float elapsed_ms) {
     float elapsed_seconds = elapsed_ms / 1000.f;
-    
-    for (auto entity : registry.animations.entities) {
-        Animation& anim = registry.animations.get(entity);
 
-        Motion motion;
-        if (registry.enemyMotions.has(entity)) {
-            motion = registry.enemyMotions.get(entity);
-        }
-        else if (registry.wallMotions.has(entity)) {
-            motion = registry.wallMotions.get(entity);
-        }
-        else if (registry.projectileMotions.has(entity)) {
-            motion = registry.projectileMotions.get(entity);
-        }
-        else {
-            motion = registry.motions.get(entity);
+    // The components are dense, so this is one pass over them in place. Only the player's
+    // motion is read, and only by reference.
+    std::vector<Animation>& animations = registry.animations.components;
+    const std::vector<Entity>& entities = registry.animations.entities;
+    for (size_t i = 0; i < animations.size(); i++) {
+        Animation& anim = animations[i];
+        if (!anim.is_playing) {
+            continue;
         }
-        if (!anim.is_playing) continue;
-
-		if (
-			(registry.players.has(entity) && (motion.velocity.x != 0 || motion.velocity.y != 0)) ||
-			(registry.enemies.has(entity) && registry.enemies.get(entity).enemyState != EnemyState::ROAMING)
-		) {
-			anim.current_time += elapsed_seconds;
-			if (anim.current_time >= anim.frame_time) {
-				anim.current_time = 0.f;
-				anim.current_frame++;
-				
-				if (anim.current_frame >= anim.num_frames) {
-					if (anim.loop) {
-						anim.current_frame = 0;
-					} else {
-						anim.current_frame = anim.num_frames - 1;
-						anim.is_playing = false;
-					}
-				}
-			}
-		} else {
-			anim.current_time = 0.f;
-			anim.current_frame = 0;
-		}
+        Entity entity = entities[i];
+        bool running = (registry.players.has(entity) && getMotion(entity).velocity != vec2(0.f)) ||
+                       (registry.enemies.has(entity) && registry.enemies.get(entity).enemyState != EnemyState::ROAMING);
+        advanceAnimation(anim, running, elapsed_seconds);
     }
 }
 
-
-void RenderSystem::drawTexturedMeshWithAnim(Entity entity, const mat3& projection, const Animation& anim) {
-	assert(registry.renderRequests.has(entity));
-    const RenderRequest& render_request = registry.renderRequests.get(entity);
-    const ivec2& tex_size = texture_dimensions[(GLuint)render_request.used_texture];
-
-    float frame_width = float(anim.sprite_width) / tex_size.x;
-    float frame_x = (anim.current_frame * anim.sprite_width) / float(tex_size.x);
-
-    std::vector<TexturedVertex> textured_vertices(4);
-    textured_vertices[0].position = { -1.f/2, +1.f/2, 0.f };
-    textured_vertices[1].position = { +1.f/2, +1.f/2, 0.f };
-    textured_vertices[2].position = { +1.f/2, -1.f/2, 0.f };
-    textured_vertices[3].position = { -1.f/2, -1.f/2, 0.f };
-    textured_vertices[0].texcoord = { frame_x, 1.f };
-    textured_vertices[1].texcoord = { frame_x + frame_width, 1.f };
-    textured_vertices[2].texcoord = { frame_x + frame_width, 0.f };
-    textured_vertices[3].texcoord = { frame_x, 0.f };
-
-    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SPRITE]);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(TexturedVertex) * textured_vertices.size(), textured_vertices.data());
+const vec4 &RenderSystem::frameUV(TEXTURE_ASSET_ID texture, const Animation &anim)
+{
+    // A sheet has one table per frame width it is drawn with, almost always just one
+    std::vector<FrameTable> &tables = m_frameTables[(GLuint)texture];
+    FrameTable *table = nullptr;
+    for (FrameTable &candidate : tables) {
+        if (candidate.sprite_width == anim.sprite_width) {
+            table = &candidate;
+            break;
+        }
+    }
+    if (table == nullptr) {
+        // Frames sit side by side along x and take the full height of the sheet
+        const ivec2 &tex_size = texture_dimensions[(GLuint)texture];
+        const float frame_width = float(anim.sprite_width) / tex_size.x;
+        const int count = std::max(1, tex_size.x / std::max(1, anim.sprite_width));
+        tables.push_back({anim.sprite_width, {}});
+        table = &tables.back();
+        for (int i = 0; i < count; i++) {
+            table->uvs.push_back(atlasSubRect(texture_uv_rects[(GLuint)texture], vec4(i * frame_width, 0.f, frame_width, 1.f)));
+        }
+    }
+    size_t frame = std::min((size_t)std::max(anim.current_frame, 0), table->uvs.size() - 1);
+    return table->uvs[frame];
 }
 
 
-void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection)
+// Characters, walls and projectiles each keep their motion in a separate container
+Motion &RenderSystem::getMotion(Entity entity)
 {
-    Motion motion;
     if (registry.enemyMotions.has(entity)) {
-        motion = registry.enemyMotions.get(entity);
+        return registry.enemyMotions.get(entity);
     }
     else if (registry.wallMotions.has(entity)) {
-        motion = registry.wallMotions.get(entity);
+        return registry.wallMotions.get(entity);
     }
     else if (registry.projectileMotions.has(entity)) {
-        motion = registry.projectileMotions.get(entity);
-    }
-    else {
-        motion = registry.motions.get(entity);
+        return registry.projectileMotions.get(entity);
     }
+    return registry.motions.get(entity);
+}
+
+Transform RenderSystem::getSpriteTransform(Entity entity, const Motion &motion)
+{
 	Transform transform;
 	transform.translate(motion.position);
-	
-	assert(registry.renderRequests.has(entity));
-	const RenderRequest &render_request = registry.renderRequests.get(entity);
 
+    // Sprites facing right are mirrored so they are never drawn upside down
     if (fabsf(motion.angle) < (M_PI/2) && !(registry.projectiles.has(entity))) {
         transform.rotate(motion.angle - M_PI);
         transform.scale(vec2(-motion.scale.x, motion.scale.y));
@@ -166,105 +190,298 @@ void RenderSystem::drawTexturedMesh(Entity entity, const mat3 &projection)
         transform.rotate(motion.angle);
         transform.scale(motion.scale);
     }
+    return transform;
+}
+
+MeshDraw RenderSystem::recordTexturedMesh(Entity entity, const mat3 &projection)
+{
+	assert(registry.renderRequests.has(entity));
+	const RenderRequest &render_request = registry.renderRequests.get(entity);
+	assert(render_request.used_effect == EFFECT_ASSET_ID::TEXTURED && "Type of render request not supported");
+	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
 
-	const GLuint used_effect_enum = (GLuint)render_request.used_effect;
-	assert(used_effect_enum != (GLuint)EFFECT_ASSET_ID::EFFECT_COUNT);
-	const GLuint program = (GLuint)effects[used_effect_enum];
+	MeshDraw mesh;
+	mesh.geometry = render_request.used_geometry;
+	mesh.texture = texture_gl_handles[(GLuint)render_request.used_texture];
+	mesh.uv_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+	mesh.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+	mesh.transform = getSpriteTransform(entity, getMotion(entity)).mat;
+	mesh.projection = projection;
+	return mesh;
+}
+
+void RenderSystem::drawMesh(const MeshDraw &mesh)
+{
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
+	const EffectLocations &locations = effect_locations[(GLuint)EFFECT_ASSET_ID::TEXTURED];
 
 	// Setting shaders
-	glUseProgram(program);
+	useProgram(program);
 	gl_has_errors();
 
-	assert(render_request.used_geometry != GEOMETRY_BUFFER_ID::GEOMETRY_COUNT);
-	const GLuint vbo = vertex_buffers[(GLuint)render_request.used_geometry];
-	const GLuint ibo = index_buffers[(GLuint)render_request.used_geometry];
-
 	// Setting vertex and index buffers
-	glBindBuffer(GL_ARRAY_BUFFER, vbo);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo);
+	bindArrayBuffer(vertex_buffers[(GLuint)mesh.geometry]);
+	bindElementBuffer(index_buffers[(GLuint)mesh.geometry]);
 	gl_has_errors();
 
 	// Input data location as in the vertex buffer
-	if (render_request.used_effect == EFFECT_ASSET_ID::TEXTURED)
-	{
-		GLint in_position_loc = glGetAttribLocation(program, "in_position");
-		GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-		gl_has_errors();
-		assert(in_texcoord_loc >= 0);
+	GLint in_position_loc = locations.in_position;
+	GLint in_texcoord_loc = locations.in_texcoord;
+	assert(in_texcoord_loc >= 0);
 
-		glEnableVertexAttribArray(in_position_loc);
-		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-							  sizeof(TexturedVertex), (void *)0);
-		gl_has_errors();
+	glEnableVertexAttribArray(in_position_loc);
+	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
+						  sizeof(TexturedVertex), (void *)0);
+	gl_has_errors();
 
-		glEnableVertexAttribArray(in_texcoord_loc);
-		glVertexAttribPointer(
-			in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-			(void *)sizeof(
-				vec3)); // note the stride to skip the preceeding vertex position
+	glEnableVertexAttribArray(in_texcoord_loc);
+	glVertexAttribPointer(
+		in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
+		(void *)sizeof(
+			vec3)); // note the stride to skip the preceeding vertex position
 
-		// Enabling and binding texture to slot 0
-		glActiveTexture(GL_TEXTURE0);
-		gl_has_errors();
+	// Enabling and binding texture to slot 0
+	glActiveTexture(GL_TEXTURE0);
+	gl_has_errors();
 
-		assert(registry.renderRequests.has(entity));
-		GLuint texture_id =
-			texture_gl_handles[(GLuint)registry.renderRequests.get(entity).used_texture];
+	// Screen textures are not in the atlas and are uploaded the first time they are drawn
+	GLuint texture_id = mesh.texture != 0 ? mesh.texture : acquireScreenTexture(mesh.screen_texture);
+	bindTexture2D(texture_id);
+	gl_has_errors();
 
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		gl_has_errors();
-	}
+	glUniform4fv(locations.uv_rect, 1, (float *)&mesh.uv_rect);
+	glUniform3fv(locations.fcolor, 1, (float *)&mesh.color);
+	gl_has_errors();
+
+	// Index count recorded when the mesh was uploaded
+	GLsizei num_indices = (GLsizei)meshes[(GLuint)mesh.geometry].num_indices;
+
+	// Setting uniform values to the currently bound program
+	glUniformMatrix3fv(locations.transform, 1, GL_FALSE, (float *)&mesh.transform);
+	glUniformMatrix3fv(locations.projection, 1, GL_FALSE, (float *)&mesh.projection);
+	gl_has_errors();
+	// Drawing of num_indices/3 triangles specified in the index buffer
+	drawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+	gl_has_errors();
+}
+
+// Draw order of the game screen, lower layers first
+enum class SPRITE_LAYER
+{
+	POWER_UPS = 0,
+	CHARACTERS = POWER_UPS + 1,
+	PROJECTILES = CHARACTERS + 1,
+	HEALTH_BARS = PROJECTILES + 1,
+};
+
+static unsigned int getSpriteLayer(Entity entity)
+{
+	if (registry.powerUps.has(entity))
+		return (unsigned int)SPRITE_LAYER::POWER_UPS;
+	if (registry.projectiles.has(entity))
+		return (unsigned int)SPRITE_LAYER::PROJECTILES;
+	return (unsigned int)SPRITE_LAYER::CHARACTERS;
+}
+
+void RenderSystem::addSprite(SpriteBatchBuilder &batch, Entity entity, unsigned int layer)
+{
+	assert(registry.renderRequests.has(entity));
+	const RenderRequest &render_request = registry.renderRequests.get(entity);
+
+	SpriteInstance instance;
+	instance.transform = getSpriteTransform(entity, getMotion(entity)).mat;
+	instance.color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
+	// Only the current frame of a sprite sheet is sampled
+	if (registry.animations.has(entity))
+		instance.uv_rect = frameUV(render_request.used_texture, registry.animations.get(entity));
 	else
+		instance.uv_rect = texture_uv_rects[(GLuint)render_request.used_texture];
+
+	// Batched by atlas page rather than by texture id
+	batch.add({layer,
+			   (unsigned int)render_request.used_effect,
+			   texture_gl_handles[(GLuint)render_request.used_texture],
+			   (unsigned int)render_request.used_geometry},
+			  instance);
+}
+
+void RenderSystem::addVisibleSprites(RenderFrame &frame)
+{
+	const vec2 view_min = frame.view_min;
+	const vec2 view_max = frame.view_max;
+	frame.sprites_drawn = 0;
+	frame.sprites_culled = 0;
+	for (Entity entity : registry.renderRequests.entities)
+	{
+		if (registry.clickables.has(entity) || registry.players.has(entity) || entity == hoverEntity || registry.walls.has(entity))
+			continue;
+		const Motion &motion = getMotion(entity);
+		// Half the diagonal bounds the sprite at any rotation
+		const float half_extent = length(motion.scale) / 2.f;
+		if (motion.position.x + half_extent < view_min.x || motion.position.x - half_extent > view_max.x ||
+			motion.position.y + half_extent < view_min.y || motion.position.y - half_extent > view_max.y)
+		{
+			frame.sprites_culled++;
+			continue;
+		}
+		addSprite(frame.sprites, entity, getSpriteLayer(entity));
+		frame.sprites_drawn++;
+	}
+}
+
+// One bar above the player and each enemy, width scaled by remaining health
+void RenderSystem::addHealthBars(RenderFrame &frame)
+{
+	const SpriteBatchKey player_key = {(unsigned int)SPRITE_LAYER::HEALTH_BARS,
+									   (unsigned int)EFFECT_ASSET_ID::TEXTURED,
+									   texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::PLAYER_HEALTH_BAR],
+									   (unsigned int)GEOMETRY_BUFFER_ID::SPRITE};
+	SpriteBatchKey enemy_key = player_key;
+	enemy_key.texture = texture_gl_handles[(GLuint)TEXTURE_ASSET_ID::HEALTH_BAR];
+
+	SpriteInstance instance;
+	instance.color = vec3(1);
+	instance.uv_rect = texture_uv_rects[(GLuint)TEXTURE_ASSET_ID::PLAYER_HEALTH_BAR];
+
+	for (Entity entity : registry.players.entities)
+	{
+		if (!registry.healths.has(entity) || !registry.motions.has(entity))
+			continue;
+		const Motion &m = registry.motions.get(entity);
+		float healthNormalized = registry.healths.get(entity).value / 100.f;
+
+		// Same orientation drawTexturedMesh gives an unrotated sprite
+		Transform transform;
+		transform.translate({m.position.x, m.position.y - abs(m.scale.y) / 2 - 15.f});
+		transform.rotate(-M_PI);
+		transform.scale({-abs(m.scale.x) * healthNormalized, 8.f});
+		instance.transform = transform.mat;
+		frame.sprites.add(player_key, instance);
+	}
+
+	const vec2 view_min = frame.view_min;
+	const vec2 view_max = frame.view_max;
+
+	instance.uv_rect = texture_uv_rects[(GLuint)TEXTURE_ASSET_ID::HEALTH_BAR];
+	for (const Motion &m : registry.enemyMotions.components)
 	{
-		assert(false && "Type of render request not supported");
+		if (!registry.healths.has(m.entity))
+			continue;
+		vec2 half_extent = abs(m.scale) / 2.f;
+		if (m.position.x + half_extent.x < view_min.x || m.position.x - half_extent.x > view_max.x ||
+			m.position.y + half_extent.y < view_min.y || m.position.y - half_extent.y - 20.f > view_max.y)
+			continue;
+		float maxHealth = registry.bosses.has(m.entity) ? 300.f : 100.f;
+		float healthNormalized = registry.healths.get(m.entity).value / maxHealth;
+
+		Transform transform;
+		transform.translate({m.position.x, m.position.y - abs(m.scale.y) / 2 - 15.f});
+		transform.rotate(-M_PI);
+		transform.scale({-abs(m.scale.x) * healthNormalized, 8.f});
+		instance.transform = transform.mat;
+		frame.sprites.add(enemy_key, instance);
 	}
+}
+
+// Issues one glDrawElementsInstanced per batch, the builder was built when recording
+void RenderSystem::drawSpriteBatches(const SpriteBatchBuilder &batch_builder, const mat3 &projection)
+{
+	const std::vector<SpriteInstance> &instances = batch_builder.instances();
+	if (instances.empty())
+		return;
 
-	// Getting uniform locations for glUniform* calls
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = registry.colors.has(entity) ? registry.colors.get(entity) : vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
+	const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED_INSTANCED];
+	const EffectLocations &locations = effect_locations[(GLuint)EFFECT_ASSET_ID::TEXTURED_INSTANCED];
+	useProgram(program);
 	gl_has_errors();
 
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+	const size_t instances_offset = streamArrayData(instances.data(), sizeof(SpriteInstance) * instances.size());
 	gl_has_errors();
 
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
+	GLint in_position_loc = locations.in_position;
+	GLint in_texcoord_loc = locations.in_texcoord;
+	GLint in_transform_loc = locations.in_transform; // a mat3 uses 3 consecutive locations
+	GLint in_color_loc = locations.in_color;
+	GLint in_uv_rect_loc = locations.in_uv_rect;
+	assert(in_transform_loc >= 0 && in_color_loc >= 0 && in_uv_rect_loc >= 0);
+	const GLint instance_locs[5] = {in_transform_loc, in_transform_loc + 1, in_transform_loc + 2, in_color_loc, in_uv_rect_loc};
 
-	GLint currProgram;
-	glGetIntegerv(GL_CURRENT_PROGRAM, &currProgram);
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(currProgram, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(currProgram, "projection");
+	GLint projection_loc = locations.projection;
 	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
+	glActiveTexture(GL_TEXTURE0);
 	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
+
+	for (const SpriteBatch &batch : batch_builder.batches())
+	{
+		assert(batch.key.effect == (unsigned int)EFFECT_ASSET_ID::TEXTURED && "Type of render request not supported");
+
+		bindArrayBuffer(vertex_buffers[batch.key.geometry]);
+		bindElementBuffer(index_buffers[batch.key.geometry]);
+		glEnableVertexAttribArray(in_position_loc);
+		glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)0);
+		glEnableVertexAttribArray(in_texcoord_loc);
+		glVertexAttribPointer(in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex), (void *)sizeof(vec3));
+
+		// Point the per-instance attributes at this batch's run of instances
+		const size_t base = instances_offset + sizeof(SpriteInstance) * batch.first_instance;
+		bindArrayBuffer(m_streamVertices.buffer());
+		for (int col = 0; col < 3; col++)
+		{
+			glVertexAttribPointer(in_transform_loc + col, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+								  (void *)(base + offsetof(SpriteInstance, transform) + sizeof(vec3) * col));
+		}
+		glVertexAttribPointer(in_color_loc, 3, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+							  (void *)(base + offsetof(SpriteInstance, color)));
+		glVertexAttribPointer(in_uv_rect_loc, 4, GL_FLOAT, GL_FALSE, sizeof(SpriteInstance),
+							  (void *)(base + offsetof(SpriteInstance, uv_rect)));
+		for (GLint loc : instance_locs)
+		{
+			glEnableVertexAttribArray(loc);
+			glVertexAttribDivisor(loc, 1);
+		}
+		gl_has_errors();
+
+		bindTexture2D(batch.key.texture);
+
+		GLsizei num_indices = (GLsizei)meshes[batch.key.geometry].num_indices;
+
+		drawElementsInstanced(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr, batch.instance_count);
+		gl_has_errors();
+	}
+
+	// The vao is shared with the non-instanced draws, so reset the per-instance state
+	for (GLint loc : instance_locs)
+	{
+		glVertexAttribDivisor(loc, 0);
+		glDisableVertexAttribArray(loc);
+	}
 	gl_has_errors();
 }
 
 // draw the intermediate texture to the screen, with some distortion to simulate
 // water
-void RenderSystem::drawToScreen()
+void RenderSystem::drawToScreen(const RenderFrame &frame)
 {
 	// Setting shaders
 	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
 
-	GLuint distortion_on = glGetUniformLocation(effects[(GLuint)EFFECT_ASSET_ID::WATER], "distort_on");
+	GLuint distortion_on = effect_locations[(GLuint)EFFECT_ASSET_ID::WATER].distort_on;
 
-    if (toggle == DISTORT_ON) {
+    if (frame.distort) {
         glUniform1i(distortion_on, 1);  
     } else {
         glUniform1i(distortion_on, 0); 
     }
 
+	// Only the part of the screen texture the scene was drawn to is stretched over the window
+	const vec2 uv_scale = vec2(m_sceneSize) / vec2(m_screenTextureSize);
+	glUniform2fv(effect_locations[(GLuint)EFFECT_ASSET_ID::WATER].uv_scale, 1, (float *)&uv_scale);
+
 	gl_has_errors();
 	// Clearing backbuffer
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glViewport(0, 0, frame.framebuffer_size.x, frame.framebuffer_size.y);
 	glDepthRange(0, 10);
 	glClearColor(0.f, 0, 0, 1.0);
 	glClearDepth(1.f);
@@ -276,33 +493,25 @@ void RenderSystem::drawToScreen()
 	glDisable(GL_DEPTH_TEST);
 
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
+	bindArrayBuffer(vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	bindElementBuffer(index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
 																	 // indices to the bound GL_ARRAY_BUFFER
 	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
+	const EffectLocations &water_locations = effect_locations[(GLuint)EFFECT_ASSET_ID::WATER];
 	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	GLuint light_up_uloc = glGetUniformLocation(water_program, "light_up");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
+	GLuint time_uloc = water_locations.time;
+	GLuint dead_timer_uloc = water_locations.darken_screen_factor;
+	GLuint light_up_uloc = water_locations.light_up;
+	glUniform1f(time_uloc, frame.time * 10.0f);
+	glUniform1f(dead_timer_uloc, frame.darken_screen_factor);
 	gl_has_errors();
 	// Set the vertex position and vertex texture coordinates (both stored in the
 	// same VBO)
 
 	// Set high score flash value
-    float light_up_amount = 0.f;
-    if (registry.lightUps.has(screen_state_entity)) {
-        LightUp& lightUp = registry.lightUps.get(screen_state_entity);
-        light_up_amount = lightUp.timer / 1.5f;
-    }
-    glUniform1f(light_up_uloc, light_up_amount);
+    glUniform1f(light_up_uloc, frame.light_up);
 
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
+	GLint in_position_loc = water_locations.in_position;
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
 	gl_has_errors();
@@ -310,10 +519,10 @@ void RenderSystem::drawToScreen()
 	// Bind our texture in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
 
-	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
+	bindTexture2D(off_screen_render_buffer_color);
 	gl_has_errors();
 	// Draw
-	glDrawElements(
+	drawElements(
 		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 				  // no offset from the bound index buffer
@@ -324,16 +533,152 @@ void RenderSystem::drawToScreen()
 // http://www.opengl-tutorial.org/intermediate-tutorials/tutorial-14-render-to-texture/
 void RenderSystem::draw(float elapsed_ms, bool isPaused)
 {
-	// Getting size of window
-	int w, h;
-	glfwGetFramebufferSize(window, &w, &h); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-	glBindVertexArray(vao);
+	if (RENDER_THREAD_TOGGLE && !m_renderThread.joinable()) {
+		startRenderThread();
+	}
+
+	// Waits while the render thread still draws the frame recorded two calls ago
+	RenderFrame *frame = m_frames.beginRecord();
+	if (frame == nullptr) {
+		return;
+	}
+	recordFrame(*frame, elapsed_ms, isPaused);
+	m_frames.publish();
+
+	if (!RENDER_THREAD_TOGGLE) {
+		frame = m_frames.acquire();
+		submitFrame(*frame);
+		// flicker-free display with a double buffer
+		glfwSwapBuffers(window);
+		gl_has_errors();
+		m_frames.release();
+	}
+}
+
+void RenderSystem::startRenderThread()
+{
+	// A context is current on one thread at a time, from here on it belongs to the render thread
+	glfwMakeContextCurrent(nullptr);
+	m_renderThread = std::thread(&RenderSystem::renderThreadMain, this);
+}
+
+void RenderSystem::renderThreadMain()
+{
+	glfwMakeContextCurrent(window);
+	while (RenderFrame *frame = m_frames.acquire()) {
+		submitFrame(*frame);
+		// flicker-free display with a double buffer
+		glfwSwapBuffers(window);
+		gl_has_errors();
+		m_frames.release();
+	}
+	glfwMakeContextCurrent(nullptr);
+}
+
+void RenderSystem::recordFrame(RenderFrame &frame, float elapsed_ms, bool isPaused)
+{
+	// Window queries are only allowed on the main thread
+	glfwGetFramebufferSize(window, &frame.framebuffer_size.x, &frame.framebuffer_size.y); // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	glfwGetWindowSize(window, &frame.window_size.x, &frame.window_size.y);
+	frame.time = (float)glfwGetTime();
+	frame.distort = toggle == DISTORT_ON;
+	frame.render_scale_mode = m_renderScaleMode;
+
+	const ScreenState &ss = registry.screenStates.get(screen_state_entity);
+	frame.active_screen = ss.activeScreen;
+	frame.darken_screen_factor = ss.darken_screen_factor;
+	// High score flash
+	frame.light_up = 0.f;
+	if (registry.lightUps.has(screen_state_entity)) {
+		frame.light_up = registry.lightUps.get(screen_state_entity).timer / 1.5f;
+	}
+
+	// Slots are reused every other frame, clearing keeps their storage
+	frame.underlays.clear();
+	frame.sprites.clear();
+	frame.player.clear();
+	frame.buttons.clear();
+	frame.light = false;
+	frame.wall_edge_lines.clear();
+	frame.text.clear();
+	frame.gestures = false;
+	frame.gesture_path.clear();
+	frame.sprites_drawn = 0;
+	frame.sprites_culled = 0;
+	frame.light_occluders_moved = 0;
+
+	// Chunks baked since the last frame go with this one
+	frame.wall_chunks.clear();
+	frame.wall_chunks_changed = m_wallChunksBaked;
+	if (m_wallChunksBaked) {
+		frame.wall_chunks.swap(m_bakedWallChunks);
+		m_wallChunksBaked = false;
+	}
+
+	if (!isPaused) {
+		updateAnimations(elapsed_ms);
+	}
+
+	if (ss.activeScreen == (int)SCREEN_ID::GAME_SCREEN || ss.activeScreen == (int)SCREEN_ID::PAUSE_SCREEN) {
+		frame.camera = createCameraMatrix();
+		getCameraBounds(frame.view_min, frame.view_max);
+		recordUnderlays(frame);
+
+		addVisibleSprites(frame);
+		addHealthBars(frame);
+		if (LIGHT_SYSTEM_TOGGLE) {
+			recordLight(frame);
+		}
+		if (debugging.in_debug_mode) {
+			recordWallEdges(frame);
+		}
+		// The player gets its own pass, drawn AFTER the shadow so it is not shaded
+		Entity player = registry.players.entities[0];
+		addSprite(frame.player, player, (unsigned int)SPRITE_LAYER::CHARACTERS);
+		frame.sprites.build();
+		frame.player.build();
+	}
+
+	if (ss.activeScreen == (int)SCREEN_ID::GAME_SCREEN) {
+		recordTexts(frame);
+		frame.gestures = mouseGestures.isToggled;
+		if (frame.gestures && mouseGestures.isHeld && !mouseGestures.gesturePath.empty()) {
+			frame.gesture_path = mouseGestures.renderPath;
+		}
+	}
+	else if (ss.activeScreen == (int)SCREEN_ID::MAIN_MENU || ss.activeScreen == (int)SCREEN_ID::PAUSE_SCREEN ||
+			 ss.activeScreen == (int)SCREEN_ID::DEATH_SCREEN || ss.activeScreen == (int)SCREEN_ID::WIN_SCREEN) {
+		recordButtons(frame);
+	}
+}
+
+void RenderSystem::submitFrame(const RenderFrame &frame)
+{
+	const int w = frame.framebuffer_size.x;
+	const int h = frame.framebuffer_size.y;
+
+	// Anything bound outside the draw functions (init, uploads) is unknown to the state cache
+	invalidateGLState();
+	m_stats = RenderStats();
+	m_stats.sprites_drawn = frame.sprites_drawn;
+	m_stats.sprites_culled = frame.sprites_culled;
+	m_stats.light_occluders_moved = frame.light_occluders_moved;
+	applyRenderScale(frame);
+	const bool timed = beginFrameTimer();
+	bindVertexArray(vao);
+
+	m_screenFrame++;
+
+	if (frame.wall_chunks_changed) {
+		clearWallChunks();
+		uploadWallChunks(frame.wall_chunks);
+	}
 
-	// First render to the custom framebuffer
+	// First render to the custom framebuffer, at the render scale
 	glBindFramebuffer(GL_FRAMEBUFFER, frame_buffer);
 	gl_has_errors();
 	// Clearing backbuffer
-	glViewport(0, 0, w, h);
+	glViewport(0, 0, m_sceneSize.x, m_sceneSize.y);
 	glDepthRange(0.00001, 10);
 
 	glClearColor(0.75f, 0.75f, 0.75f, 1.0f); // black space background
@@ -347,171 +692,141 @@ void RenderSystem::draw(float elapsed_ms, bool isPaused)
 							  // sprites back to front
 	gl_has_errors();
 
-
-	/* mat3 projection_2D = createProjectionMatrix(); */
-	mat3 projection_2D = createCameraMatrix();
-
-    if (!isPaused) {
-        updateAnimations(elapsed_ms);
-    }
-
-	// Draw all textured meshes that have a position and size component
-    const ScreenState& ss = registry.screenStates.get(screen_state_entity);
-    if (ss.activeScreen == (int)SCREEN_ID::MAIN_MENU) {
-        drawMainMenu();
+    prefetchLikelyScreens(frame.active_screen);
+    if (frame.active_screen == (int)SCREEN_ID::MAIN_MENU) {
+        drawScreenImage(frame, SCREEN_TEXTURE_ID::MAIN_MENU);
+        drawButtons(frame);
     }
-	else if (ss.activeScreen == (int)SCREEN_ID::TUTORIAL_SCREEN) {
-		drawTutorial();
+	else if (frame.active_screen == (int)SCREEN_ID::TUTORIAL_SCREEN) {
+		drawScreenImage(frame, SCREEN_TEXTURE_ID::TUTORIAL);
     }
-    else if (ss.activeScreen == (int)SCREEN_ID::GAME_SCREEN || ss.activeScreen == (int) SCREEN_ID::PAUSE_SCREEN) {
+    else if (frame.active_screen == (int)SCREEN_ID::GAME_SCREEN || frame.active_screen == (int) SCREEN_ID::PAUSE_SCREEN) {
 
-        drawGameBackground();
-        drawSpaceship();
-        drawFloor();
+        for (const MeshDraw &mesh : frame.underlays) {
+            drawMesh(mesh);
+        }
 
-        for (Entity entity : registry.renderRequests.entities)
-        {
-            if (registry.clickables.has(entity) || registry.players.has(entity) || entity == hoverEntity) 
-                continue;
-            // Note, its not very efficient to access elements indirectly via the entity
-            // albeit iterating through all Sprites in sequence. A good point to optimize
-                
-            if (registry.animations.has(entity)) {
-                drawTexturedMeshWithAnim(entity, projection_2D, registry.animations.get(entity));
-            }
-            drawTexturedMesh(entity, projection_2D);
+        // Walls are drawn from the chunks baked with the room
+        drawWallChunks(frame);
+
+        drawSpriteBatches(frame.sprites, frame.camera);
+        if (frame.light) {
+            lightScreen(frame);
         }
-        if (LIGHT_SYSTEM_TOGGLE) {
-            lightScreen();
+        if (!frame.wall_edge_lines.empty()) {
+            drawWallEdges(frame);
         }
         // Draw player AFTER shadow has been cast so it is not shaded
-        Entity player = registry.players.entities[0];
-        drawTexturedMeshWithAnim(player, projection_2D, registry.animations.get(player));
-        drawTexturedMesh(player, projection_2D);
+        drawSpriteBatches(frame.player, frame.camera);
         
-        glBindVertexArray(vao);
+        bindVertexArray(vao);
     }
-    else if (ss.activeScreen == (int) SCREEN_ID::DEATH_SCREEN) {
-        drawDeathScreen();
+    else if (frame.active_screen == (int) SCREEN_ID::DEATH_SCREEN) {
+        drawScreenImage(frame, SCREEN_TEXTURE_ID::DEATH_SCREEN);
+        drawButtons(frame);
     }
-    else if (ss.activeScreen == (int) SCREEN_ID::WIN_SCREEN) {
-        drawWinScreen();
+    else if (frame.active_screen == (int) SCREEN_ID::WIN_SCREEN) {
+        drawScreenImage(frame, SCREEN_TEXTURE_ID::WIN_SCREEN);
+        drawButtons(frame);
     }
 
 	// Truely render to the screen
-	drawToScreen();
+	drawToScreen(frame);
 
-    if (ss.activeScreen == (int)SCREEN_ID::GAME_SCREEN)
+    if (frame.active_screen == (int)SCREEN_ID::GAME_SCREEN)
 	{
 		// Render text
-		glBindVertexArray(0);
+		bindVertexArray(0);
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
         glViewport(0, 0, w, h);
 
-		int w, h;
-		glfwGetWindowSize(window, &w, &h);
-
-		std::vector<TextRenderRequest> texts = {};
-
-		for (Entity entity: registry.texts.entities) {
-			Text &text = registry.texts.get(entity);
-			texts.emplace_back(text.text, text.position.x, h - text.position.y, text.scale, text.color, glm::mat4(4.0f));
-		}
-		
-		if (!texts.empty()) {
-			renderTextBulk(texts);
-		}
-		if (mouseGestures.isToggled) {
-			drawMouseGestures();
+		flushText(frame.text);
+		if (frame.gestures) {
+			drawMouseGestures(frame);
 		}
 	}
 
-    else if (ss.activeScreen == (int) SCREEN_ID::PAUSE_SCREEN) {
+    else if (frame.active_screen == (int) SCREEN_ID::PAUSE_SCREEN) {
 		glEnable(GL_BLEND);
 		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-		int w, h;
-		glfwGetFramebufferSize(window, &w, &h);
         glViewport(0, 0, w, h);
-        drawPauseMenu();
+        drawScreenImage(frame, SCREEN_TEXTURE_ID::PAUSE_MENU);
+        drawButtons(frame);
     }
 
-	// flicker-free display with a double buffer
-	glfwSwapBuffers(window);
-	gl_has_errors();
-}
+	if (timed) {
+		endFrameTimer();
+	}
+	m_stats.render_scale = m_renderScale;
+	m_stats.gpu_frame_ms = m_gpuFrameMs;
 
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	m_publishedStats = m_stats;
+}
 
+RenderSystem::RenderStats RenderSystem::getRenderStats() const
+{
+	std::lock_guard<std::mutex> lock(m_statsMutex);
+	return m_publishedStats;
+}
 
-void RenderSystem::drawMouseGestures() {
-    glUseProgram(ges_shaderProgram);
+void RenderSystem::drawMouseGestures(const RenderFrame &frame) {
+    useProgram(ges_shaderProgram);
     gl_has_errors();
-    glUniform1f(glGetUniformLocation(ges_shaderProgram, "thickness"), 4.0f);
-    glBindVertexArray(ges_VAO);
-    auto &path = mouseGestures.renderPath;
+    glUniform1f(ges_thickness_loc, 4.0f);
+    bindVertexArray(ges_VAO);
+    const std::vector<vec2> &path = frame.gesture_path;
     
-    if (mouseGestures.isHeld && !mouseGestures.gesturePath.empty()) {
-        std::vector<vec2> expandedPath;
-        std::vector<float> sides;
-        
+    if (!path.empty()) {
+        // Each point becomes both edges of the strip, side picks which way it is pushed out
+        struct GestureVertex
+        {
+            vec2 position;
+            float side;
+        };
+        std::vector<GestureVertex> strip;
+        strip.reserve(path.size() * 2);
         for (const auto& point : path) {
-            expandedPath.push_back(point);
-            expandedPath.push_back(point);
-            sides.push_back(-1.0f);
-            sides.push_back(1.0f);
+            strip.push_back({point, -1.0f});
+            strip.push_back({point, 1.0f});
         }
 
-        glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-        glBufferData(GL_ARRAY_BUFFER, expandedPath.size() * sizeof(vec2), expandedPath.data(), GL_DYNAMIC_DRAW);
-        gl_has_errors();
-
-        GLuint sideVBO;
-        glGenBuffers(1, &sideVBO);
-        glBindBuffer(GL_ARRAY_BUFFER, sideVBO);
-        glBufferData(GL_ARRAY_BUFFER, sides.size() * sizeof(float), sides.data(), GL_DYNAMIC_DRAW);
+        const size_t base = streamArrayData(strip.data(), strip.size() * sizeof(GestureVertex));
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(GestureVertex), (void*)base);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(GestureVertex), (void*)(base + offsetof(GestureVertex, side)));
         gl_has_errors();
-
-        glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), (void*)0);
-        glEnableVertexAttribArray(0);
-
-        glBindBuffer(GL_ARRAY_BUFFER, sideVBO);
-        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, expandedPath.size());
-        glDeleteBuffers(1, &sideVBO);
+        drawArrays(GL_TRIANGLE_STRIP, 0, (GLsizei)strip.size());
     }
 
-    glBindVertexArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    bindVertexArray(0);
+    bindArrayBuffer(0);
     gl_has_errors();
 }
 
-void RenderSystem::drawMainMenu() {
-
-    // Draw buttons first since drawing front to back
-    // Setting shaders
+// The menus draw their image over the whole screen with the water effect
+void RenderSystem::drawScreenImage(const RenderFrame &frame, SCREEN_TEXTURE_ID id) {
+	// Setting shaders
 	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
+	useProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
 	gl_has_errors();
 	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
+	bindArrayBuffer(vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
+	bindElementBuffer(index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
 																	 // indices to the bound GL_ARRAY_BUFFER
 	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
+	const EffectLocations &water_locations = effect_locations[(GLuint)EFFECT_ASSET_ID::WATER];
 	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState &screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
+	GLuint time_uloc = water_locations.time;
+	GLuint dead_timer_uloc = water_locations.darken_screen_factor;
+	glUniform1f(time_uloc, frame.time * 10.0f);
+	glUniform1f(dead_timer_uloc, frame.darken_screen_factor);
+	// Menu images are sampled whole
+	glUniform2f(water_locations.uv_scale, 1.f, 1.f);
 	gl_has_errors();
 	// Set the vertex position and vertex texture coordinates (both stored in the
 	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
+	GLint in_position_loc = water_locations.in_position;
 	glEnableVertexAttribArray(in_position_loc);
 	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void *)0);
 	gl_has_errors();
@@ -519,62 +834,17 @@ void RenderSystem::drawMainMenu() {
 	// Bind our texture in Texture Unit 0
 	glActiveTexture(GL_TEXTURE0);
 
-	glBindTexture(GL_TEXTURE_2D, mainMenuTexture);
+	bindTexture2D(acquireScreenTexture(id));
 	gl_has_errors();
 	// Draw
-	glDrawElements(
+	drawElements(
 		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
 		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
 				  // no offset from the bound index buffer
-    drawButtons();
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawTutorial() {
-
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, tutorialTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
 	gl_has_errors();
 }
 
-void RenderSystem::drawButtons() {
+void RenderSystem::recordButtons(RenderFrame &frame) {
     mat3 projection_2D = createProjectionMatrix();
     bool anyButtonHoveredOver = false;
     for (Entity e : registry.clickables.entities) {
@@ -591,7 +861,7 @@ void RenderSystem::drawButtons() {
                         GEOMETRY_BUFFER_ID::UI_COMPONENT
                         });
             }
-            drawTexturedMesh(hoverEntity, projection_2D);
+            frame.buttons.push_back(recordTexturedMesh(hoverEntity, projection_2D));
         }
         if (!registry.renderRequests.has(e)) {
             registry.renderRequests.insert(e, {
@@ -600,7 +870,7 @@ void RenderSystem::drawButtons() {
                     GEOMETRY_BUFFER_ID::UI_COMPONENT
                     });
         }
-        drawTexturedMesh(e, projection_2D);
+        frame.buttons.push_back(recordTexturedMesh(e, projection_2D));
     }
 
     if (!anyButtonHoveredOver && registry.renderRequests.has(hoverEntity)){
@@ -609,13 +879,18 @@ void RenderSystem::drawButtons() {
 
 }
 
+void RenderSystem::drawButtons(const RenderFrame &frame) {
+    for (const MeshDraw &button : frame.buttons) {
+        drawMesh(button);
+    }
+}
+
 mat3 RenderSystem::createProjectionMatrix()
 {
 	// Fake projection matrix, scales with respect to window coordinates
 	float left = 0.f;
 	float top = 0.f;
 
-	gl_has_errors();
 	float right = (float) window_width_px;
 	float bottom = (float) window_height_px;
 
@@ -626,21 +901,28 @@ mat3 RenderSystem::createProjectionMatrix()
 	return {{sx, 0.f, 0.f}, {0.f, sy, 0.f}, {tx, ty, 1.f}};
 }
 
-mat3 RenderSystem::createCameraMatrix()
+void RenderSystem::getCameraBounds(vec2 &min, vec2 &max)
 {
-	// Fake projection matrix, scales with respect to window coordinates
-
     int w, h;
     glfwGetFramebufferSize(window, &w, &h);
     Entity p = registry.players.entities[0];
     Motion& m = registry.motions.get(p);
 
-	float left = m.position.x - w/2;
-	float top = m.position.y - h/2;
+    min = {m.position.x - w/2, m.position.y - h/2};
+    max = {m.position.x + w/2, m.position.y + h/2};
+}
 
-	gl_has_errors();
-	float right = m.position.x + w/2;
-	float bottom = m.position.y + h/2;
+mat3 RenderSystem::createCameraMatrix()
+{
+	// Fake projection matrix, scales with respect to window coordinates
+    vec2 view_min, view_max;
+    getCameraBounds(view_min, view_max);
+
+	float left = view_min.x;
+	float top = view_min.y;
+
+	float right = view_max.x;
+	float bottom = view_max.y;
 
 	float sx = 2.f / (right - left);
 	float sy = 2.f / (top - bottom);
@@ -659,340 +941,37 @@ int RenderSystem::getActiveScreen() const {
     return ss.activeScreen;
 }
 
-void RenderSystem::drawPauseMenu() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, pauseMenuTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
-    drawButtons();
-
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawDeathScreen() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, deathScreenTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
-    drawButtons();
-
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawWinScreen() {
-	// Draw buttons first since drawing front to back
-	// Setting shaders
-	// get the water texture, sprite mesh, and program
-	glUseProgram(effects[(GLuint)EFFECT_ASSET_ID::WATER]);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-	const GLuint water_program = effects[(GLuint)EFFECT_ASSET_ID::WATER];
-	// Set clock
-	GLuint time_uloc = glGetUniformLocation(water_program, "time");
-	GLuint dead_timer_uloc = glGetUniformLocation(water_program, "darken_screen_factor");
-	glUniform1f(time_uloc, (float)(glfwGetTime() * 10.0f));
-	ScreenState& screen = registry.screenStates.get(screen_state_entity);
-	glUniform1f(dead_timer_uloc, screen.darken_screen_factor);
-	gl_has_errors();
-	// Set the vertex position and vertex texture coordinates (both stored in the
-	// same VBO)
-	GLint in_position_loc = glGetAttribLocation(water_program, "in_position");
-	glEnableVertexAttribArray(in_position_loc);
-	glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
-	gl_has_errors();
-
-	// Bind our texture in Texture Unit 0
-	glActiveTexture(GL_TEXTURE0);
-
-	glBindTexture(GL_TEXTURE_2D, winScreenTexture);
-	gl_has_errors();
-	// Draw
-	glDrawElements(
-		GL_TRIANGLES, 3, GL_UNSIGNED_SHORT,
-		nullptr); // one triangle = 3 vertices; nullptr indicates that there is
-	// no offset from the bound index buffer
-
-    drawButtons();
-
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawGameBackground() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    gl_has_errors();
-    assert(in_texcoord_loc >= 0);
-
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    glBindTexture(GL_TEXTURE_2D, gameBackgroundTexture);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-    Transform transform;
-    int w, h;
-    glfwGetWindowSize(window, &w, &h);
-    transform.translate(vec2(w,h));
-    transform.scale(vec2(6000,-3000));
-    mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
-}
-
-void RenderSystem::drawFloor() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::FLOOR]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::FLOOR]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    gl_has_errors();
-    assert(in_texcoord_loc >= 0);
-
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    glBindTexture(GL_TEXTURE_2D, floorTexture);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-    Transform transform;
-    /* transform.translate(vec2(500,300)); */
-    /* transform.scale(vec2(200,-200)); */
-    mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
+void RenderSystem::recordUnderlays(RenderFrame &frame) {
+    const int w = frame.window_size.x;
+    const int h = frame.window_size.y;
+
+    // Not in the atlas, the whole screen texture is sampled
+    MeshDraw background;
+    background.geometry = GEOMETRY_BUFFER_ID::UI_COMPONENT;
+    background.screen_texture = SCREEN_TEXTURE_ID::GAME_BACKGROUND;
+    background.projection = frame.camera;
+    Transform background_transform;
+    background_transform.translate(vec2(w,h));
+    background_transform.scale(vec2(6000,-3000));
+    background.transform = background_transform.mat;
+    frame.underlays.push_back(background);
+
+    MeshDraw spaceship = background;
+    spaceship.screen_texture = SCREEN_TEXTURE_ID::SPACESHIP;
+    Transform spaceship_transform;
+    spaceship_transform.translate(vec2(w,h));
+    spaceship_transform.scale(vec2(w*3.0f,-h*3.0f));
+    spaceship.transform = spaceship_transform.mat;
+    frame.underlays.push_back(spaceship);
+
+    // The floor geometry is already in world space
+    MeshDraw floor = background;
+    floor.geometry = GEOMETRY_BUFFER_ID::FLOOR;
+    floor.screen_texture = SCREEN_TEXTURE_ID::FLOOR;
+    floor.transform = mat3(1.f);
+    frame.underlays.push_back(floor);
 }
 
-void RenderSystem::drawSpaceship() {
-    const GLuint program = effects[(GLuint)EFFECT_ASSET_ID::TEXTURED];
-	glUseProgram(program);
-	gl_has_errors();
-	// Draw the screen texture on the quad geometry
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]);
-	glBindBuffer(
-		GL_ELEMENT_ARRAY_BUFFER,
-		index_buffers[(GLuint)GEOMETRY_BUFFER_ID::UI_COMPONENT]); // Note, GL_ELEMENT_ARRAY_BUFFER associates
-	// indices to the bound GL_ARRAY_BUFFER
-	gl_has_errors();
-    GLint in_position_loc = glGetAttribLocation(program, "in_position");
-    GLint in_texcoord_loc = glGetAttribLocation(program, "in_texcoord");
-    gl_has_errors();
-    assert(in_texcoord_loc >= 0);
-
-    glEnableVertexAttribArray(in_position_loc);
-    glVertexAttribPointer(in_position_loc, 3, GL_FLOAT, GL_FALSE,
-                          sizeof(TexturedVertex), (void *)0);
-    gl_has_errors();
-
-    glEnableVertexAttribArray(in_texcoord_loc);
-    glVertexAttribPointer(
-        in_texcoord_loc, 2, GL_FLOAT, GL_FALSE, sizeof(TexturedVertex),
-        (void *)sizeof(
-            vec3)); // note the stride to skip the preceeding vertex position
-
-    // Enabling and binding texture to slot 0
-    glActiveTexture(GL_TEXTURE0);
-    gl_has_errors();
-
-    glBindTexture(GL_TEXTURE_2D, spaceshipTexture);
-    gl_has_errors();
-
-    // Getting uniform locations for glUniform* calls
-
-	// Get number of indices from index buffer, which has elements uint16_t
-	GLint size = 0;
-	glGetBufferParameteriv(GL_ELEMENT_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
-	gl_has_errors();
-
-	GLsizei num_indices = size / sizeof(uint16_t);
-	// GLsizei num_triangles = num_indices / 3;
-
-    int w, h;
-    glfwGetWindowSize(window, &w, &h);
-    Transform transform;
-
-    transform.translate(vec2(w,h));
-    transform.scale(vec2(w*3.0f,-h*3.0f));
-    mat3 projection = createCameraMatrix();
-
-	GLint color_uloc = glGetUniformLocation(program, "fcolor");
-	const vec3 color = vec3(1);
-	glUniform3fv(color_uloc, 1, (float *)&color);
-	gl_has_errors();
-	// Setting uniform values to the currently bound program
-	GLuint transform_loc = glGetUniformLocation(program, "transform");
-	glUniformMatrix3fv(transform_loc, 1, GL_FALSE, (float *)&transform.mat);
-	GLuint projection_loc = glGetUniformLocation(program, "projection");
-	glUniformMatrix3fv(projection_loc, 1, GL_FALSE, (float *)&projection);
-	gl_has_errors();
-	// Drawing of num_indices/3 triangles specified in the index buffer
-	glDrawElements(GL_TRIANGLES, num_indices, GL_UNSIGNED_SHORT, nullptr);
-	gl_has_errors();
-
-}
 void RenderSystem::flipActiveButtions(int activeScreen) {
     for (Entity e : registry.clickables.entities) {
         Clickable& c = registry.clickables.get(e);
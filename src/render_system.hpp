@@ -6,10 +6,33 @@
 #include "common.hpp"
 #include "components.hpp"
 #include "tiny_ecs.hpp"
+#include "sprite_batch.hpp"
+#include "texture_atlas.hpp"
+#include "asset_archive.hpp"
+#include "thread_pool.hpp"
+#include "stream_buffer.hpp"
+#include "visibility.hpp"
+#include "light_scene.hpp"
+#include "outline_table.hpp"
+#include "scratch_arena.hpp"
+#include "render_frame.hpp"
+#include "dynamic_resolution.hpp"
 
 #include "../ext/freetype/include/ft2build.h"
 #include FT_FREETYPE_H
+#include <cstdint>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Resident screen textures are evicted least recently used first above this
+const size_t SCREEN_TEXTURE_BUDGET_BYTES = 24 * 1024 * 1024;
+
+// GPU time per frame RENDER_SCALE_MODE::DYNAMIC holds, leaves room under a 60 Hz vsync
+const float DYNAMIC_RESOLUTION_TARGET_MS = 14.f;
+const float MIN_RENDER_SCALE = 0.5f;
 
 // System responsible for setting up OpenGL and for rendering all the
 // visual entities in the game
@@ -22,8 +45,14 @@ class RenderSystem
      * Whenever possible, add to these lists instead of creating dynamic state
      * it is easier to debug and faster to execute for the computer.
      */
+    // All textures are packed into atlas pages at startup. texture_gl_handles holds the
+    // page each texture lives in and texture_uv_rects its offset (xy) and size (zw) there.
+    std::vector<GLuint> atlas_gl_handles;
     std::array<GLuint, texture_count> texture_gl_handles;
+    std::array<vec4, texture_count> texture_uv_rects;
     std::array<ivec2, texture_count> texture_dimensions;
+    const int MAX_ATLAS_SIZE = 2048;
+    const int ATLAS_PADDING = 1;
 
     // Make sure these paths remain in sync with the associated enumerators.
     // Associated id with .obj path
@@ -60,11 +89,34 @@ class RenderSystem
     };
 
     std::array<GLuint, effect_count> effects;
+
+    // Attribute and uniform locations of every effect, looked up once in initializeGlEffects.
+    // -1 where the effect does not use the name, which glUniform* quietly ignores
+    struct EffectLocations
+    {
+        GLint in_position = -1;
+        GLint in_texcoord = -1;
+        GLint in_color = -1;
+        GLint in_transform = -1;
+        GLint in_uv_rect = -1;
+        GLint projection = -1;
+        GLint transform = -1;
+        GLint fcolor = -1;
+        GLint uv_rect = -1;
+        GLint time = -1;
+        GLint darken_screen_factor = -1;
+        GLint light_up = -1;
+        GLint distort_on = -1;
+        GLint shadow_on = -1;
+        GLint uv_scale = -1;
+    };
+    std::array<EffectLocations, effect_count> effect_locations;
     // Make sure these paths remain in sync with the associated enumerators.
     const std::array<std::string, effect_count> effect_paths = {
         shader_path("textured"),
         shader_path("water"),
         shader_path("light"),
+        shader_path("textured_instanced"),
     };
 
     std::array<GLuint, geometry_count> vertex_buffers;
@@ -72,8 +124,9 @@ class RenderSystem
     std::array<Mesh, geometry_count> meshes;
 
 public:
-    // Initialize the window
-    bool init(GLFWwindow *window);
+    // Initialize the window. Assets come from the archive at asset_archive_path when it
+    // exists, otherwise from the loose files.
+    bool init(GLFWwindow *window, const std::string &asset_archive_path);
 
     bool fontInit(GLFWwindow* window, const std::string& font_filename, unsigned int font_default_size);
 
@@ -82,6 +135,32 @@ public:
 
     void initializeGlTextures();
 
+    // RGBA pixels ready for glTexImage2D. Points into the asset archive when it has the
+    // image, otherwise stb_image decoded it and freeImagePixels releases it.
+    struct ImagePixels
+    {
+        const unsigned char *data = nullptr;
+        ivec2 size = {0, 0};
+        unsigned char *decoded = nullptr;
+    };
+    bool loadImagePixels(const std::string &path, ImagePixels &out);
+    void freeImagePixels(ImagePixels &image);
+
+    // Starts decoding every entity texture on the load pool, loadImagePixels then waits
+    // for the one it asks for. Screen images are not included, acquireScreenTexture and
+    // prefetchLikelyScreens load those lazily
+    void prefetchImages();
+    ImagePixels decodeImagePixels(const std::string &path) const;
+
+    // Screen texture residency: textures are decoded and uploaded the first time a screen
+    // is drawn, screens likely to come next are decoded ahead on the load pool
+    void initScreenTextures();
+    GLuint acquireScreenTexture(SCREEN_TEXTURE_ID id);
+    void prefetchScreenTexture(SCREEN_TEXTURE_ID id);
+    void prefetchLikelyScreens(int active_screen);
+    void setScreenTextureBudget(size_t bytes);
+    size_t getResidentScreenTextureBytes() const { return m_screenTextureBytes; }
+
     void initializeGlEffects();
 
     void initializeGlMeshes();
@@ -94,28 +173,16 @@ public:
     bool initScreenTexture();
 
     bool initMainMenu(bool saveFileExists);
-    void drawMainMenu();
-
-    bool initTutorial();
-    void drawTutorial();
-
     bool initPauseMenu();
-    void drawPauseMenu();
-
     bool initDeathScreen();
-    void drawDeathScreen();
-
     bool initWinScreen();
-    void drawWinScreen();
 
-    bool initGameBackground();
-    void drawGameBackground();
+    // Full screen image of a menu, then its buttons
+    void drawScreenImage(const RenderFrame &frame, SCREEN_TEXTURE_ID id);
+    void drawButtons(const RenderFrame &frame);
 
-    bool initFloor();
-    void drawFloor();
-    
-    bool initSpaceship();
-    void drawSpaceship();
+    // Background, spaceship and floor behind the room
+    void recordUnderlays(RenderFrame &frame);
 
     bool mouseGestureInit();
 
@@ -132,43 +199,181 @@ public:
 
     Entity createHoverEffect();
 
-    void drawButtons();
+    // Buttons of the active screen, adds the hover border under the hovered one
+    void recordButtons(RenderFrame &frame);
 
     bool doesSaveFileExist();
 
     void initLight();
-    std::vector<vec2> getEntityCurrentVertices(Entity& e);
+    // Polygon of each light, reused until the light or an occluder in its reach moves.
+    // Entries of lights that were not drawn in a frame are dropped.
+    struct LightCache
+    {
+        vec2 position;
+        vec2 bounds_min;
+        vec2 bounds_max;
+        unsigned int frame = 0;
+        std::vector<vec2> polygon;
+    };
     int getCurrentFrame(Entity& e);
-    std::vector<Ray> generateWallRays();
-    std::vector<Ray> generateRays(std::vector<vec2>& vertices);
-    std::vector<LineSegment> generateWallSegments();
-    std::vector<LineSegment> generateLineSegments(std::vector<vec2>& vertices);
-    float getRayIntersectionDist(Ray& ray, LineSegment& segment);
-    std::vector<std::array<float, 2>> getLitArea(std::vector<Ray>& rays, std::vector<LineSegment>& segments);
-    void lightScreen();
+    // Occluders for the light: the wall silhouette and the outline of every character
+    // Return whether the walls changed since the last frame
+    bool collectWallSegments(std::vector<VisibilitySegment>& out);
+    void collectOutlineSegments(Entity& e, OUTLINE_ID outline, RenderFrame& frame);
+    // Occluders, where they moved, and the lights, recorded for the render thread
+    void recordLight(RenderFrame& frame);
+    // Lights whose reach overlaps the camera cut their visibility polygon out of the shadow
+    void lightScreen(const RenderFrame& frame);
+    bool lightBounds(const Light& light, vec2 view_min, vec2 view_max, vec2& bounds_min, vec2& bounds_max);
+    bool lightNeedsUpdate(const LightCache& cache, const Light& light, vec2 bounds_min, vec2 bounds_max,
+                          const std::vector<vec4>& dirty_regions) const;
+    void computeLightPolygon(LightCache& cache, const Light& light, vec2 bounds_min, vec2 bounds_max,
+                             const RenderFrame& frame);
+    // Debug mode overlay of the wall silhouette the light and line of sight use
+    void recordWallEdges(RenderFrame& frame);
+    void drawWallEdges(const RenderFrame& frame);
 
     // Destroy resources associated to one or all entities created by the system
     ~RenderSystem();
 
-    // Draw all entities
+    // Record all entities into a frame and hand it to the render thread
     void draw(float elapsed_ms, bool isPaused);
 
-    void drawMouseGestures();
+    void drawMouseGestures(const RenderFrame &frame);
 
     mat3 createProjectionMatrix();
     mat3 createCameraMatrix();
+    // World-space rectangle shown by createCameraMatrix
+    void getCameraBounds(vec2 &min, vec2 &max);
+
+    // Bake the walls of the current room into static chunks, call once the room is created.
+    // The chunks are uploaded by the render thread with the next frame.
+    void bakeWallChunks();
+
+    // Counts from the last game-screen frame, shown next to the FPS
+    struct RenderStats
+    {
+        unsigned int sprites_drawn = 0;
+        unsigned int sprites_culled = 0;
+        unsigned int chunks_drawn = 0;
+        unsigned int chunks_culled = 0;
+        // Binds that reached the driver, and binds the state cache skipped
+        unsigned int gl_binds = 0;
+        unsigned int gl_binds_skipped = 0;
+        unsigned int draw_calls = 0;
+        // Dynamic geometry written to the stream rings, and how often a ring was orphaned
+        size_t stream_bytes = 0;
+        unsigned int stream_orphans = 0;
+        // Lights drawn, skipped for being off camera, and whose polygon had to be recomputed
+        unsigned int lights_drawn = 0;
+        unsigned int lights_culled = 0;
+        unsigned int lights_computed = 0;
+        unsigned int light_occluders_moved = 0;
+        // Fraction of the window the scene was drawn at, and the GPU time of a recent frame
+        float render_scale = 1.f;
+        float gpu_frame_ms = 0.f;
+    };
+    // Copy of the stats of the last frame the render thread finished
+    RenderStats getRenderStats() const;
+
+    // Saves the light inputs of the next recorded frame to path.scene and their software
+    // shadow mask, one pixel per SHADOW_MASK_CELL world units, to path.pgm. Copied into
+    // data/light_scenes they become a golden image for the tests.
+    bool saveLightScene(const std::string &path);
+    const float SHADOW_MASK_CELL = 10.f;
 
     GLFWwindow* getWindow() {return window;};
+    // Nothing reads Light components while this is off, so they are not created
+    bool lightSystemEnabled() const {return LIGHT_SYSTEM_TOGGLE;};
+
+    // Takes effect with the next recorded frame
+    void setRenderScaleMode(RENDER_SCALE_MODE mode) { m_renderScaleMode = mode; }
+    RENDER_SCALE_MODE getRenderScaleMode() const { return m_renderScaleMode; }
 
 private:
+    // Binds go through these so a bind of what is already bound never reaches the driver.
+    // Code binding with raw gl calls must invalidateGLState() afterwards
+    struct GLStateCache
+    {
+        // Never a GL name, so the first bind of each always goes through
+        static const GLuint UNKNOWN_BINDING = ~0u;
+        GLuint program = UNKNOWN_BINDING;
+        GLuint vertex_array = UNKNOWN_BINDING;
+        GLuint array_buffer = UNKNOWN_BINDING;
+        GLuint element_buffer = UNKNOWN_BINDING; // part of the vertex array state
+        GLuint texture_2d = UNKNOWN_BINDING;
+    };
+    GLStateCache m_glState;
+    void invalidateGLState();
+    void useProgram(GLuint program);
+    void bindVertexArray(GLuint vertex_array);
+    void bindArrayBuffer(GLuint buffer);
+    void bindElementBuffer(GLuint buffer);
+    void bindTexture2D(GLuint texture);
+    // Call before deleting a name, it may be reused by the next glGen*
+    void forgetBuffer(GLuint buffer);
+    void forgetTexture(GLuint texture);
+    void drawElements(GLenum mode, GLsizei count, GLenum type, const void *indices);
+    void drawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instance_count);
+    void drawArrays(GLenum mode, GLint first, GLsizei count);
+
+    // Per-frame geometry is suballocated from these rings instead of getting its own
+    // buffer upload. Both bind their ring and return the byte offset of the data in it;
+    // the index ring binds into the current vertex array.
+    StreamBuffer m_streamVertices;
+    StreamBuffer m_streamIndices;
+    const size_t STREAM_VERTEX_BYTES = 4 * 1024 * 1024;
+    const size_t STREAM_INDEX_BYTES = 256 * 1024;
+    size_t streamArrayData(const void *data, size_t size);
+    size_t streamElementData(const void *data, size_t size);
+
+    // Advances every playing animation in the dense component array
     void updateAnimations(float elapsed_ms);
-    void drawTexturedMeshWithAnim(Entity entity, const mat3& projection, const Animation& anim);
+
+    // UV rect of every frame of a sprite sheet, already placed in the atlas, built the first
+    // time a sheet is drawn with a frame width so sprites only index it
+    struct FrameTable
+    {
+        int sprite_width;
+        std::vector<vec4> uvs;
+    };
+    std::array<std::vector<FrameTable>, texture_count> m_frameTables;
+    const vec4 &frameUV(TEXTURE_ASSET_ID texture, const Animation &anim);
+
+    Motion &getMotion(Entity entity);
+    Transform getSpriteTransform(Entity entity, const Motion &motion);
+
+    // The simulation thread copies what a frame shows out of the registry, the render
+    // thread draws it. Only the record functions read the registry, only the draw
+    // functions make GL calls.
+    void recordFrame(RenderFrame &frame, float elapsed_ms, bool isPaused);
+    void submitFrame(const RenderFrame &frame);
+    void startRenderThread();
+    void renderThreadMain();
+    RenderFrameQueue m_frames;
+    std::thread m_renderThread;
+    // Off to record and draw on the main thread, one frame after the other
+    bool RENDER_THREAD_TOGGLE = true;
 
     // Internal drawing functions for each entity type
-    void drawTexturedMesh(Entity entity, const mat3 &projection);
-    void drawToScreen();
+    MeshDraw recordTexturedMesh(Entity entity, const mat3 &projection);
+    void drawMesh(const MeshDraw &mesh);
+
+    // Sprites of the game screen are collected and drawn as instanced batches
+    void addSprite(SpriteBatchBuilder &batch, Entity entity, unsigned int layer);
+    void addHealthBars(RenderFrame &frame);
+    void drawSpriteBatches(const SpriteBatchBuilder &batch_builder, const mat3 &projection);
+
+    void clearWallChunks();
+    void uploadWallChunks(const std::vector<WallChunkData> &chunks);
+    void drawWallChunks(const RenderFrame &frame);
+
+    // Record the sprites of the game screen that overlap the camera
+    void addVisibleSprites(RenderFrame &frame);
+    void drawToScreen(const RenderFrame &frame);
 
-    void renderTextBulk(std::vector<TextRenderRequest>& requests);
+    // Lays out every Text component, reusing their cached layouts
+    void recordTexts(RenderFrame& frame);
 
     // Window handle
     GLFWwindow *window;
@@ -177,32 +382,38 @@ private:
     GLuint frame_buffer;
     GLuint off_screen_render_buffer_color;
     GLuint off_screen_render_buffer_depth_stencil;
+    ivec2 m_screenTextureSize = {0, 0};
+
+    // The scene fills the lower left m_renderScale of the screen texture, drawToScreen
+    // stretches that part over the window. Set by the main thread, applied by the render thread.
+    RENDER_SCALE_MODE m_renderScaleMode = RENDER_SCALE_MODE::FULL;
+    RENDER_SCALE_MODE m_appliedScaleMode = RENDER_SCALE_MODE::FULL;
+    float m_renderScale = 1.f;
+    ivec2 m_sceneSize = {0, 0};
+    DynamicResolution m_dynamicResolution;
+    void applyRenderScale(const RenderFrame &frame);
+
+    // GPU time of whole frames from GL_TIME_ELAPSED queries. Results are read a few
+    // frames late so waiting for them never stalls the pipeline.
+    static const int FRAME_TIMER_QUERIES = 3;
+    GLuint m_frameTimerQueries[FRAME_TIMER_QUERIES] = {};
+    bool m_frameTimerPending[FRAME_TIMER_QUERIES] = {};
+    int m_frameTimer = 0;
+    float m_gpuFrameMs = 0.f;
+    bool beginFrameTimer();
+    void endFrameTimer();
 
     Entity screen_state_entity;
     Entity hoverEntity;
 
-    GLuint mainMenuTexture;
+    // Screen images, uploaded lazily through m_screenTextures
     const std::string mainMenuImgPath = textures_path("ui/main-menu.png");
-
-    GLuint tutorialTexture;
     const std::string tutorialImgPath = textures_path("ui/tutorial.png");
-
-    GLuint pauseMenuTexture;
     const std::string pauseMenuImgPath = textures_path("ui/pause-menu.png");
-
-    GLuint deathScreenTexture;
     const std::string deathScreenImgPath = textures_path("ui/death-screen.png");
-
-    GLuint winScreenTexture;
     const std::string winScreenImgPath = textures_path("ui/win-screen.png");
-
-    GLuint gameBackgroundTexture;
     const std::string gameBackgroundImgPath = textures_path("spaceship-background.png");
-
-    GLuint floorTexture;
     const std::string floorImgPath = textures_path("floor-tile.png");
-
-    GLuint spaceshipTexture;
     const std::string spaceshipImgPath = textures_path("spaceship.png");
 
     const float MENU_BUTTON_HEIGHT = 90.f;
@@ -212,260 +423,115 @@ private:
 
     GLuint vao;
 
-    GLuint m_light_VAO;
-    GLuint m_light_VBO;
-
-    std::map<char, Character> m_ftCharacters;
-	GLuint m_font_shaderProgram;
-	GLuint m_font_VAO;
-	GLuint m_font_VBO;
-
-    const std::vector<vec2> playerFrame1 = {
-        vec2(0.500, 0.035),
-            vec2(-0.500, -0.086),
-            vec2(-0.236, 0.488),
-            vec2(-0.013, -0.500),
-            vec2(-0.342, -0.463),
-            vec2(-0.072, 0.500),
-            vec2(-0.372, 0.383),
-    };
-    // Made svg outlines of each sprite frame and got a python script to extract the vertices
-
-    const std::vector<vec2> playerFrame2 = 
-        {
-        vec2(-0.305, -0.484),
-        vec2(0.500, 0.053),
-        vec2(0.045, -0.500),
-        vec2(-0.378, 0.373),
-        vec2(-0.142, -0.332),
-        vec2(-0.240, 0.500),
-        vec2(-0.061, 0.500),
-        vec2(-0.439, -0.393),
-        vec2(-0.500, -0.057),
-    };
-
-    const std::vector<vec2> playerFrame3 = 
-        {
-        vec2(-0.074, 0.500),
-        vec2(-0.369, 0.384),
-        vec2(0.500, 0.006),
-        vec2(-0.142, -0.483),
-        vec2(-0.222, 0.494),
-        vec2(-0.500, -0.087),
-        vec2(-0.312, -0.500),
-    };
-
-    const std::vector<vec2> playerFrame4 =
-        {
-        vec2(0.043, -0.500),
-        vec2(-0.289, -0.484),
-        vec2(-0.059, 0.500),
-        vec2(-0.144, -0.333),
-        vec2(-0.354, 0.374),
-        vec2(-0.500, -0.053),
-        vec2(0.500, 0.045),
-        vec2(-0.435, -0.378),
-        vec2(-0.245, 0.480),
-    };
-
-    const std::vector<vec2> playerFrame5 =
-        {
-        vec2(-0.239, 0.500),
-        vec2(-0.500, -0.084),
-        vec2(-0.295, -0.500),
-        vec2(-0.062, 0.478),
-        vec2(-0.125, -0.483),
-        vec2(0.500, 0.011),
-        vec2(-0.375, 0.337),
-    };
-
-    const std::array<std::vector<vec2>, 5> playerOutlineVertices = 
+    // Walls of one WALL_CHUNK_TILES x WALL_CHUNK_TILES area sharing a texture, in world space
+    struct StaticChunk
     {
-        std::vector<vec2>(playerFrame1),
-        std::vector<vec2>(playerFrame2),
-        std::vector<vec2>(playerFrame3),
-        std::vector<vec2>(playerFrame4),
-        std::vector<vec2>(playerFrame5),
+        GLuint vbo;
+        GLuint ibo;
+        GLsizei num_indices;
+        TEXTURE_ASSET_ID texture;
+        vec2 min;
+        vec2 max;
     };
+    std::vector<StaticChunk> m_wallChunks;
+    const int WALL_CHUNK_TILES = 16;
+    // Baked on the simulation thread, moved into the next recorded frame
+    std::vector<WallChunkData> m_bakedWallChunks;
+    bool m_wallChunksBaked = false;
 
-    const std::vector<vec2> meleeEnemyFrame1 = {
-        vec2(-0.261, -0.489),
-        vec2(-0.303, 0.500),
-        vec2(0.076, -0.462),
-        vec2(0.340, -0.335),
-        vec2(0.445, -0.243),
-        vec2(0.500, 0.052),
-        vec2(-0.424, -0.301),
-        vec2(-0.500, -0.044),
-        vec2(-0.059, -0.500),
-        vec2(0.282, 0.489),
-        vec2(-0.408, 0.351),
-    };
-    const std::vector<vec2> meleeEnemyFrame2 = {
-        vec2(-0.025, -0.492),
-        vec2(-0.224, -0.500),
-        vec2(0.500, 0.088),
-        vec2(-0.301, 0.500),
-        vec2(0.406, -0.212),
-        vec2(-0.500, -0.364),
-        vec2(-0.461, 0.317),
-        vec2(0.218, 0.500),
-    };
-    const std::vector<vec2> meleeEnemyFrame3 = {
-        vec2(0.012, -0.500),
-        vec2(0.264, 0.477),
-        vec2(0.500, 0.053),
-        vec2(0.431, -0.239),
-        vec2(-0.347, -0.485),
-        vec2(-0.500, 0.326),
-        vec2(-0.382, 0.178),
-        vec2(-0.347, 0.500),
-    };
-    const std::vector<vec2> meleeEnemyFrame4 = {
-        vec2(-0.483, 0.370),
-        vec2(0.500, 0.085),
-        vec2(0.218, 0.492),
-        vec2(-0.322, 0.500),
-        vec2(-0.040, -0.496),
-        vec2(-0.241, -0.500),
-        vec2(-0.500, -0.385),
-        vec2(0.397, -0.211),
-    };
-    const std::vector<vec2> meleeEnemyFrame5 = {
-        vec2(0.500, 0.076),
-        vec2(-0.375, 0.375),
-        vec2(-0.282, 0.496),
-        vec2(0.442, -0.249),
-        vec2(-0.251, -0.492),
-        vec2(-0.500, -0.045),
-        vec2(0.302, 0.500),
-        vec2(-0.430, -0.304),
-        vec2(0.029, -0.500),
-    };
+    // Baked by the asset-baker target, mapped for the lifetime of the renderer
+    AssetArchive m_assets;
 
-    const std::array<std::vector<vec2>, 5> meleeEnemyOutlineVertices = 
+    struct ScreenTexture
     {
-        std::vector<vec2>(meleeEnemyFrame1),
-        std::vector<vec2>(meleeEnemyFrame2),
-        std::vector<vec2>(meleeEnemyFrame3),
-        std::vector<vec2>(meleeEnemyFrame4),
-        std::vector<vec2>(meleeEnemyFrame5),
+        std::string path;
+        GLint filter = GL_LINEAR;
+        bool repeat = false;
+        GLuint handle = 0; // 0 while not resident
+        size_t bytes = 0;
+        unsigned int last_used_frame = 0;
+        std::future<ImagePixels> pending; // valid while a prefetch is decoding or waiting
     };
+    std::array<ScreenTexture, screen_texture_count> m_screenTextures;
+    size_t m_screenTextureBytes = 0;
+    size_t m_screenTextureBudget = SCREEN_TEXTURE_BUDGET_BYTES;
+    unsigned int m_screenFrame = 0;
+    void evictScreenTextures();
+    void clearScreenTextures();
+
+    // Worker threads for startup decoding and glyph rasterization
+    std::unique_ptr<ThreadPool> m_loadPool;
+    std::unordered_map<std::string, std::future<ImagePixels>> m_pendingImages;
+    // Counted by the render thread while drawing, copied out once a frame is done
+    RenderStats m_stats;
+    RenderStats m_publishedStats;
+    mutable std::mutex m_statsMutex;
 
-
-    const std::vector<vec2> rangedEnemyFrame1 = {
-        vec2(-0.037, -0.449),
-        vec2(-0.359, 0.500),
-        vec2(-0.500, 0.301),
-        vec2(-0.347, -0.500),
-        vec2(0.500, 0.062),
-        vec2(-0.150, 0.477),
-    };
-    const std::vector<vec2> rangedEnemyFrame2 = {
-        vec2(-0.500, 0.325),
-        vec2(0.500, 0.048),
-        vec2(-0.403, 0.500),
-        vec2(-0.191, -0.477),
-        vec2(-0.329, -0.500),
-        vec2(-0.174, 0.472),
-    };
-
-    const std::vector<vec2> rangedEnemyFrame3 = {
-        vec2(-0.386, 0.500),
-        vec2(-0.045, -0.500),
-        vec2(-0.347, -0.500),
-        vec2(-0.142, 0.460),
-        vec2(-0.187, -0.402),
-        vec2(-0.500, 0.322),
-        vec2(0.500, 0.052),
-    };
-
-    const std::vector<vec2> rangedEnemyFrame4 = {
-        vec2(0.500, 0.029),
-        vec2(-0.350, -0.471),
-        vec2(-0.188, -0.500),
-        vec2(-0.500, 0.305),
-        vec2(-0.408, 0.500),
-        vec2(-0.176, 0.477),
-    };
-
-    const std::vector<vec2> rangedEnemyFrame5 = {
-        vec2(0.500, 0.063),
-        vec2(-0.422, -0.477),
-        vec2(-0.500, 0.494),
-        vec2(-0.205, -0.408),
-        vec2(-0.090, -0.500),
-        vec2(-0.235, -0.477),
-        vec2(-0.217, 0.500),
-    };
-
-    const std::array<std::vector<vec2>, 5> rangedEnemyOutlineVertices = 
+    GLuint m_light_VAO;
+    VisibilitySweep m_visibility;
+    std::unordered_map<unsigned int, LightCache> m_lightCache;
+    unsigned int m_lightFrame = 0;
+    // Where each character's outline was last recorded. Characters that moved, turned,
+    // changed frame or went away mark their old and new boxes in the frame's
+    // light_dirty_regions, only lights whose reach touches one are recomputed.
+    struct OccluderState
     {
-        std::vector<vec2>(rangedEnemyFrame1),
-        std::vector<vec2>(rangedEnemyFrame2),
-        std::vector<vec2>(rangedEnemyFrame1),
-        std::vector<vec2>(rangedEnemyFrame4),
-        std::vector<vec2>(rangedEnemyFrame5),
-    };
-
-    const std::vector<vec2> bossEnemyFrame1 = {
-        vec2(0.020, -0.494),
-        vec2(-0.246, 0.496),
-        vec2(0.268, 0.362),
-        vec2(0.018, 0.500),
-        vec2(-0.500, 0.368),
-        vec2(-0.378, -0.500),
-        vec2(0.500, 0.018),
-    };
-    const std::vector<vec2> bossEnemyFrame2 = {
-        vec2(-0.494, -0.311),
-        vec2(-0.247, 0.498),
-        vec2(0.020, 0.500),
-        vec2(-0.500, 0.369),
-        vec2(0.500, 0.002),
-        vec2(-0.192, -0.500),
-        vec2(0.273, 0.338),
-    };
-    const std::vector<vec2> bossEnemyFrame3 = {
-        vec2(-0.255, 0.496),
-        vec2(-0.403, -0.414),
-        vec2(0.011, 0.500),
-        vec2(0.500, -0.004),
-        vec2(-0.113, -0.500),
-        vec2(-0.500, 0.361),
-        vec2(0.273, 0.350),
-    };
-    const std::vector<vec2> bossEnemyFrame4 = {
-        vec2(-0.099, -0.500),
-        vec2(-0.500, 0.368),
-        vec2(0.500, -0.002),
-        vec2(0.031, 0.496),
-        vec2(0.274, 0.346),
-        vec2(-0.235, 0.500),
-        vec2(-0.490, -0.416),
-    };
-    const std::vector<vec2> bossEnemyFrame5 = {
-        vec2(0.032, 0.490),
-        vec2(0.257, 0.374),
-        vec2(-0.291, -0.500),
-        vec2(-0.500, 0.360),
-        vec2(0.500, 0.010),
-        vec2(0.042, -0.482),
-        vec2(-0.243, 0.500),
+        OUTLINE_ID outline;
+        int frame;
+        vec2 position;
+        float angle;
+        vec2 scale;
+        vec2 box_min;
+        vec2 box_max;
+        unsigned int seen = 0;
     };
+    std::unordered_map<unsigned int, OccluderState> m_occluderStates;
+    unsigned int m_occluderFrame = 0;
+    unsigned int m_lightWallVersion = 0;
+    // Lights drawn this and last frame, the fans are only rebuilt and uploaded when they differ
+    std::vector<unsigned int> m_lightsDrawn;
+    std::vector<unsigned int> m_lightsDrawnBefore;
+    GLuint m_lightFanVBO = 0;
+    GLuint m_lightFanIBO = 0;
+    std::vector<VisibilitySegment> m_lightNearby;
+    // Fan of the light polygon, kept so their storage is reused every frame
+    std::vector<vec3> m_lightFanVertices;
+    std::vector<uint16_t> m_lightFanIndices;
+    // Transformed outlines of the frame, reset at the start of recordLight
+    ScratchArena m_lightArena{4 * 1024};
+    std::string m_lightScenePath; // asked for, not yet recorded
+    void writeLightScene(const RenderFrame &frame);
+
+    // First 128 ASCII chars indexed by code, all sampling the one font atlas
+    std::array<Character, 128> m_ftCharacters;
+	GLuint m_font_shaderProgram;
+	GLuint m_font_VAO;
+	GLuint m_font_atlas = 0;
+	const int GLYPH_ATLAS_SIZE = 1024;
+	const int GLYPH_ATLAS_PADDING = 1;
+
+	void appendText(const TextLayout &layout, vec2 origin, vec3 color, const glm::mat4 &transform,
+	                std::vector<TextVertex> &out);
+	void flushText(const std::vector<TextVertex> &vertices);
+
+	// Text layouts keyed by (string, scale). The cache is dropped and the generation bumped
+	// when it grows past TEXT_LAYOUT_CACHE_LIMIT, which tells Text components to look again
+	struct TextLayoutKeyHash
+	{
+		size_t operator()(const std::pair<std::string, float> &key) const
+		{
+			return std::hash<std::string>()(key.first) ^ (std::hash<float>()(key.second) << 1);
+		}
+	};
+	std::unordered_map<std::pair<std::string, float>, TextLayout, TextLayoutKeyHash> m_textLayouts;
+	unsigned int m_textLayoutGeneration = 1;
+	const size_t TEXT_LAYOUT_CACHE_LIMIT = 512;
+	const TextLayout &getTextLayout(const std::string &text, float scale);
+	const TextLayout &resolveTextLayout(Text &text);
 
-    const std::array<std::vector<vec2>, 5> bossEnemyOutlineVertices = 
-    {
-        std::vector<vec2>(bossEnemyFrame1),
-        std::vector<vec2>(bossEnemyFrame2),
-        std::vector<vec2>(bossEnemyFrame1),
-        std::vector<vec2>(bossEnemyFrame4),
-        std::vector<vec2>(bossEnemyFrame5),
-    };
-    
     GLuint ges_shaderProgram;
+    GLint ges_thickness_loc;
     GLuint ges_VAO;
-    GLuint ges_VBO;
 
     bool distortColor = false;
     bool LIGHT_SYSTEM_TOGGLE = false;
@@ -475,6 +541,6 @@ private:
 
 };
 
-bool loadEffectFromFile(
+bool loadEffectFromFile(const AssetArchive &assets,
     const std::string &vs_path, const std::string &fs_path, GLuint &out_program);
 
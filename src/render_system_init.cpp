@@ -18,6 +18,8 @@
 #include "world_init.hpp"
 
 // stlib
+#include <chrono>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 
@@ -29,7 +31,7 @@ bool RenderSystem::doesSaveFileExist() {
 }
 
 // World initialization
-bool RenderSystem::init(GLFWwindow* window_arg)
+bool RenderSystem::init(GLFWwindow* window_arg, const std::string& asset_archive_path)
 {
 	this->window = window_arg;
 
@@ -69,7 +71,21 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 	glBindVertexArray(vao);
 	gl_has_errors();
 
+	// Startup cost is dominated by asset loading, log it so the archive path can be compared
+	auto load_start = std::chrono::high_resolution_clock::now();
+	if (!m_assets.open(asset_archive_path, PROJECT_SOURCE_DIR))
+		printf("No asset archive, loading loose files (build the bake-assets target to create it)\n");
+
+	// Decode everything on worker threads up front, the init functions below only
+	// wait for the image they upload so uploads overlap the remaining decodes
+	stbi_set_flip_vertically_on_load(true);
+	m_loadPool.reset(new ThreadPool());
+	prefetchImages();
+	initScreenTextures();
+
 	initScreenTexture();
+	glGenQueries(FRAME_TIMER_QUERIES, m_frameTimerQueries);
+	m_dynamicResolution.configure(DYNAMIC_RESOLUTION_TARGET_MS, MIN_RENDER_SCALE, 1.f);
     initializeGlTextures();
 	initializeGlEffects();
 	initializeGlGeometryBuffers();
@@ -77,48 +93,62 @@ bool RenderSystem::init(GLFWwindow* window_arg)
 
     saveFileExists = doesSaveFileExist();
     initMainMenu(saveFileExists);
-	initTutorial();
     initPauseMenu();
     initDeathScreen();
     initWinScreen();
-    initGameBackground();
-    initFloor();
-    initSpaceship();
 
     if (LIGHT_SYSTEM_TOGGLE) {
         initLight();
     }
 
+	float load_ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - load_start).count();
+	printf("Loaded render assets in %.1f ms (%s)\n", load_ms, m_assets.isOpen() ? "archive" : "loose files");
+
 
 	return true;
 }
 
-std::string readShaderFile(const std::string& filename)
+// Text of a shader or other asset, straight from the archive when it was baked
+static bool readAssetText(const AssetArchive& assets, const std::string& path, std::string& out)
 {
-	std::cout << "Loading shader filename: " << filename << std::endl;
-
-	std::ifstream ifs(filename);
+	const AssetTocEntry* entry = assets.find(assetName(PROJECT_SOURCE_DIR, path));
+	if (entry != nullptr && entry->type == (uint32_t)ASSET_TYPE::SHADER)
+	{
+		out.assign((const char*)assets.data(*entry), (size_t)entry->size);
+		return true;
+	}
 
+	std::ifstream ifs(path);
 	if (!ifs.good())
+		return false;
+	std::ostringstream oss;
+	oss << ifs.rdbuf();
+	out = oss.str();
+	return true;
+}
+
+std::string readShaderFile(const AssetArchive& assets, const std::string& filename)
+{
+	std::cout << "Loading shader filename: " << filename << std::endl;
+
+	std::string source;
+	if (!readAssetText(assets, filename, source))
 	{
 		std::cerr << "ERROR: invalid filename loading shader from file: " << filename << std::endl;
 		return "";
 	}
 
-	std::ostringstream oss;
-	oss << ifs.rdbuf();
-	std::cout << oss.str() << std::endl;
-	return oss.str();
+	std::cout << source << std::endl;
+	return source;
 }
 
 bool RenderSystem::mouseGestureInit() {
-	std::string vertexShaderSource = readShaderFile(PROJECT_SOURCE_DIR + std::string("shaders/gesture.vs.glsl"));
-	std::string fragmentShaderSource = readShaderFile(PROJECT_SOURCE_DIR + std::string("shaders/gesture.fs.glsl"));
+	std::string vertexShaderSource = readShaderFile(m_assets, PROJECT_SOURCE_DIR + std::string("shaders/gesture.vs.glsl"));
+	std::string fragmentShaderSource = readShaderFile(m_assets, PROJECT_SOURCE_DIR + std::string("shaders/gesture.fs.glsl"));
 	const char* vertexShaderSource_c = vertexShaderSource.c_str();
 	const char* fragmentShaderSource_c = fragmentShaderSource.c_str();
 
 	glGenVertexArrays(1, &ges_VAO);
-	glGenBuffers(1, &ges_VBO);
 
 	unsigned int gest_vertexShader;
 	gest_vertexShader = glCreateShader(GL_VERTEX_SHADER);
@@ -144,27 +174,107 @@ bool RenderSystem::mouseGestureInit() {
 	assert(project_location > -1);
 	std::cout << "project_location: " << project_location << std::endl;
 	glUniformMatrix4fv(project_location, 1, GL_FALSE, glm::value_ptr(projection));
+	ges_thickness_loc = glGetUniformLocation(ges_shaderProgram, "thickness");
 
 	glDeleteShader(gest_vertexShader);
 	glDeleteShader(ges_fragmentShader);
 
+	// The path itself is streamed by drawMouseGestures
 	glBindVertexArray(ges_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, ges_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(vec2) * 1024, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(vec2), 0);
-
-	// release buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glEnableVertexAttribArray(1);
 	glBindVertexArray(0);
 
 	return true;
 }
 
+// A rendered glyph copied out of FreeType, ready to upload
+struct GlyphBitmap
+{
+	unsigned char character = 0;
+	bool loaded = false;
+	glm::ivec2 size = {0, 0};
+	glm::ivec2 bearing = {0, 0};
+	unsigned int advance = 0;
+	std::vector<unsigned char> pixels;
+};
+
+struct GlyphChunk
+{
+	bool font_loaded = false;
+	std::vector<GlyphBitmap> glyphs;
+};
+
+// Every chunk opens its own FreeType library and face, neither is safe to share across threads
+static GlyphChunk rasterizeGlyphs(const unsigned char* font_data, size_t font_size, const std::string& font_filename,
+	unsigned int pixel_size, unsigned int first, unsigned int last)
+{
+	GlyphChunk chunk;
+	FT_Library ft;
+	if (FT_Init_FreeType(&ft))
+		return chunk;
+
+	FT_Face face;
+	FT_Error font_error = font_data != nullptr
+		? FT_New_Memory_Face(ft, font_data, (FT_Long)font_size, 0, &face)
+		: FT_New_Face(ft, font_filename.c_str(), 0, &face);
+	if (font_error)
+	{
+		FT_Done_FreeType(ft);
+		return chunk;
+	}
+	chunk.font_loaded = true;
+
+	// extract a default size
+	FT_Set_Pixel_Sizes(face, 0, pixel_size);
+
+	for (unsigned int c = first; c < last; c++)
+	{
+		GlyphBitmap glyph;
+		glyph.character = (unsigned char)c;
+		glyph.loaded = FT_Load_Char(face, c, FT_LOAD_RENDER) == 0;
+		if (glyph.loaded)
+		{
+			// Copy out tightly packed, the glyph slot is reused by the next load
+			const FT_Bitmap& bitmap = face->glyph->bitmap;
+			glyph.size = glm::ivec2(bitmap.width, bitmap.rows);
+			glyph.bearing = glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top);
+			glyph.advance = static_cast<unsigned int>(face->glyph->advance.x);
+			glyph.pixels.resize((size_t)bitmap.width * bitmap.rows);
+			for (unsigned int row = 0; row < bitmap.rows; row++)
+				memcpy(glyph.pixels.data() + (size_t)row * bitmap.width, bitmap.buffer + (ptrdiff_t)row * bitmap.pitch, bitmap.width);
+		}
+		chunk.glyphs.push_back(std::move(glyph));
+	}
+
+	FT_Done_Face(face);
+	FT_Done_FreeType(ft);
+	return chunk;
+}
+
 bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename, unsigned int font_default_size) {
+	// Rasterize the first 128 ASCII chars on the load pool while the shaders compile here.
+	// The archive stays mapped, so FreeType can read the font from it in place
+	const AssetTocEntry* font_entry = m_assets.find(assetName(PROJECT_SOURCE_DIR, font_filename));
+	if (font_entry != nullptr && font_entry->type != (uint32_t)ASSET_TYPE::RAW)
+		font_entry = nullptr;
+	const unsigned char* font_data = font_entry != nullptr ? m_assets.data(*font_entry) : nullptr;
+	size_t font_size = font_entry != nullptr ? (size_t)font_entry->size : 0;
+	const unsigned int glyph_count = (unsigned int)m_ftCharacters.size();
+	unsigned int chunk_count = std::max(1u, std::min(m_loadPool->size(), glyph_count));
+	std::vector<std::future<GlyphChunk>> glyph_chunks;
+	for (unsigned int i = 0; i < chunk_count; i++)
+	{
+		unsigned int first = glyph_count * i / chunk_count;
+		unsigned int last = glyph_count * (i + 1) / chunk_count;
+		glyph_chunks.push_back(m_loadPool->submit([=]() {
+			return rasterizeGlyphs(font_data, font_size, font_filename, font_default_size, first, last);
+		}));
+	}
+
 	// read in our shader files
-	std::string vertexShaderSource = readShaderFile(PROJECT_SOURCE_DIR + std::string("shaders/font.vs.glsl"));
-	std::string fragmentShaderSource = readShaderFile(PROJECT_SOURCE_DIR + std::string("shaders/font.fs.glsl"));
+	std::string vertexShaderSource = readShaderFile(m_assets, PROJECT_SOURCE_DIR + std::string("shaders/font.vs.glsl"));
+	std::string fragmentShaderSource = readShaderFile(m_assets, PROJECT_SOURCE_DIR + std::string("shaders/font.fs.glsl"));
 	const char* vertexShaderSource_c = vertexShaderSource.c_str();
 	const char* fragmentShaderSource_c = fragmentShaderSource.c_str();
 
@@ -174,7 +284,6 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 
 	// font buffer setup
 	glGenVertexArrays(1, &m_font_VAO);
-	glGenBuffers(1, &m_font_VBO);
 
 	// font vertex shader
 	unsigned int font_vertexShader;
@@ -208,77 +317,81 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 	glDeleteShader(font_vertexShader);
 	glDeleteShader(font_fragmentShader);
 
-	// init FreeType fonts
-	FT_Library ft;
-	if (FT_Init_FreeType(&ft))
+	// Gather the glyphs as their chunks finish rasterizing
+	bool glyphs_ok = true;
+	std::vector<GlyphBitmap> glyphs;
+	for (std::future<GlyphChunk>& pending : glyph_chunks)
 	{
-		std::cerr << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-		return false;
+		GlyphChunk chunk = pending.get();
+		if (!chunk.font_loaded)
+		{
+			glyphs_ok = false;
+			continue;
+		}
+		for (GlyphBitmap& glyph : chunk.glyphs)
+		{
+			if (!glyph.loaded)
+				std::cerr << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
+			glyphs.push_back(std::move(glyph));
+		}
 	}
-
-	FT_Face face;
-	if (FT_New_Face(ft, font_filename.c_str(), 0, &face))
+	if (!glyphs_ok)
 	{
 		std::cerr << "ERROR::FREETYPE: Failed to load font: " << font_filename << std::endl;
 		return false;
 	}
 
-	// extract a default size
-	FT_Set_Pixel_Sizes(face, 0, font_default_size);
-
-	// disable byte-alignment restriction in OpenGL
-	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-	// load each of the chars - note only first 128 ASCII chars
-	for (unsigned char c = (unsigned char)0; c < (unsigned char)128; c++)
+	// Bake every glyph into one single channel atlas so text draws with one texture
+	std::vector<ivec2> sizes(glyphs.size());
+	for (size_t i = 0; i < glyphs.size(); i++)
+		sizes[i] = glyphs[i].size;
+	AtlasLayout layout;
+	if (!packAtlas(sizes, GLYPH_ATLAS_SIZE, GLYPH_ATLAS_PADDING, layout) || layout.page_sizes.size() != 1)
 	{
-		// load character glyph 
-		if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-		{
-			std::cerr << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-			continue;
-		}
-
-		// generate texture
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_2D, texture);
-
-		// std::cout << "texture: " << c << " = " << texture << std::endl;
-
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, face->glyph->bitmap.width, face->glyph->bitmap.rows, 0, GL_RED, GL_UNSIGNED_BYTE, face->glyph->bitmap.buffer);
-
-		// set texture options
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		fprintf(stderr, "Glyphs do not fit in one %d pixel atlas", GLYPH_ATLAS_SIZE);
+		assert(false);
+		return false;
+	}
+	const ivec2 page_size = layout.page_sizes[0];
+	std::vector<unsigned char> page(page_size.x * page_size.y, 0);
+	m_ftCharacters.fill(Character());
+	for (size_t i = 0; i < glyphs.size(); i++)
+	{
+		const GlyphBitmap& glyph = glyphs[i];
+		const AtlasPlacement& placement = layout.placements[i];
+		for (int row = 0; row < glyph.size.y; row++)
+			memcpy(&page[(placement.y + row) * page_size.x + placement.x], &glyph.pixels[row * glyph.size.x], glyph.size.x);
 
 		// now store character for later use
 		Character character = {
-			texture,
-			glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-			glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-			static_cast<unsigned int>(face->glyph->advance.x),
-			(char)c
+			0,
+			glyph.size,
+			glyph.bearing,
+			glyph.advance,
+			(char)glyph.character,
+			atlasUVRect(placement, glyph.size, page_size)
 		};
-		m_ftCharacters.insert(std::pair<char, Character>(c, character));
+		m_ftCharacters[glyph.character] = character;
 	}
-	glBindTexture(GL_TEXTURE_2D, 0);
 
-	// clean up
-	FT_Done_Face(face);
-	FT_Done_FreeType(ft);
+	// disable byte-alignment restriction in OpenGL
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glGenTextures(1, &m_font_atlas);
+	glBindTexture(GL_TEXTURE_2D, m_font_atlas);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, page_size.x, page_size.y, 0, GL_RED, GL_UNSIGNED_BYTE, page.data());
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	for (Character& character : m_ftCharacters)
+		character.TextureID = m_font_atlas;
+	gl_has_errors();
 
-	// bind buffers
+	// The vertices are streamed every frame, flushText points the attributes at them
 	glBindVertexArray(m_font_VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, m_font_VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
 	glEnableVertexAttribArray(0);
-	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-
-	// release buffers
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glEnableVertexAttribArray(1);
 	glBindVertexArray(0);
 
 	return true;
@@ -286,33 +399,117 @@ bool RenderSystem::fontInit(GLFWwindow* window, const std::string& font_filename
 
 void RenderSystem::initializeGlTextures()
 {
-    glGenTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
-
+    // Decode every texture first, then pack them into as few atlas pages as possible
+    std::array<ImagePixels, texture_count> pixels;
+    std::vector<ivec2> sizes(texture_count);
     for(uint i = 0; i < texture_paths.size(); i++)
     {
 		const std::string& path = texture_paths[i];
-		ivec2& dimensions = texture_dimensions[i];
-
-		stbi_uc* data;
-        stbi_set_flip_vertically_on_load(true);
-		data = stbi_load(path.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
 
-		if (data == NULL)
+		if (!loadImagePixels(path, pixels[i]))
 		{
 			const std::string message = "Could not load the file " + path + ".";
 			fprintf(stderr, "%s", message.c_str());
 			assert(false);
 		}
-		glBindTexture(GL_TEXTURE_2D, texture_gl_handles[i]);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
+		texture_dimensions[i] = pixels[i].size;
+		sizes[i] = pixels[i].size;
+    }
+
+	GLint max_size = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_size);
+	max_size = std::min(max_size, MAX_ATLAS_SIZE);
+
+	AtlasLayout layout;
+	bool packed = packAtlas(sizes, max_size, ATLAS_PADDING, layout);
+	if (!packed)
+	{
+		fprintf(stderr, "A texture is larger than the %d pixel atlas", max_size);
+		assert(false);
+	}
+
+	std::vector<std::vector<unsigned char>> pages(layout.page_sizes.size());
+	for (uint p = 0; p < pages.size(); p++)
+		pages[p].assign(layout.page_sizes[p].x * layout.page_sizes[p].y * 4, 0);
+
+	for (uint i = 0; i < texture_count; i++)
+	{
+		const AtlasPlacement& placement = layout.placements[i];
+		blitIntoAtlas(pages[placement.page], layout.page_sizes[placement.page], pixels[i].data, sizes[i], placement, ATLAS_PADDING);
+		freeImagePixels(pixels[i]);
+	}
+
+	atlas_gl_handles.resize(pages.size());
+	glGenTextures((GLsizei)atlas_gl_handles.size(), atlas_gl_handles.data());
+	for (uint p = 0; p < pages.size(); p++)
+	{
+		glBindTexture(GL_TEXTURE_2D, atlas_gl_handles[p]);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, layout.page_sizes[p].x, layout.page_sizes[p].y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages[p].data());
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
 		gl_has_errors();
-		stbi_image_free(data);
-    }
+	}
+	printf("Packed %d textures into %d atlas page(s)\n", texture_count, (int)pages.size());
+
+	// Textures are looked up by id as before, the handle is now the atlas page holding it
+	for (uint i = 0; i < texture_count; i++)
+	{
+		const AtlasPlacement& placement = layout.placements[i];
+		texture_gl_handles[i] = atlas_gl_handles[placement.page];
+		texture_uv_rects[i] = atlasUVRect(placement, sizes[i], layout.page_sizes[placement.page]);
+	}
 	gl_has_errors();
 }
 
+void RenderSystem::prefetchImages()
+{
+	for (const std::string& path : texture_paths)
+	{
+		if (m_pendingImages.count(path) == 0)
+			m_pendingImages[path] = m_loadPool->submit([this, path]() { return decodeImagePixels(path); });
+	}
+}
+
+// Runs on the load pool: only reads the archive and decodes, no GL
+RenderSystem::ImagePixels RenderSystem::decodeImagePixels(const std::string& path) const
+{
+	ImagePixels out;
+	const AssetTocEntry* entry = m_assets.find(assetName(PROJECT_SOURCE_DIR, path));
+	if (entry != nullptr && entry->type == (uint32_t)ASSET_TYPE::IMAGE_RGBA)
+	{
+		out.data = m_assets.data(*entry);
+		out.size = {(int)entry->width, (int)entry->height};
+		return out;
+	}
+
+	// Flipping was switched on once in init, stb_image keeps it in a global
+	out.decoded = stbi_load(path.c_str(), &out.size.x, &out.size.y, NULL, 4);
+	out.data = out.decoded;
+	return out;
+}
+
+bool RenderSystem::loadImagePixels(const std::string& path, ImagePixels& out)
+{
+	auto pending = m_pendingImages.find(path);
+	if (pending != m_pendingImages.end())
+	{
+		out = pending->second.get();
+		m_pendingImages.erase(pending);
+	}
+	else
+	{
+		out = decodeImagePixels(path);
+	}
+	return out.data != nullptr;
+}
+
+void RenderSystem::freeImagePixels(ImagePixels& image)
+{
+	if (image.decoded != nullptr)
+		stbi_image_free(image.decoded);
+	image = ImagePixels();
+}
+
 void RenderSystem::initializeGlEffects()
 {
 	for(uint i = 0; i < effect_paths.size(); i++)
@@ -320,8 +517,28 @@ void RenderSystem::initializeGlEffects()
 		const std::string vertex_shader_name = effect_paths[i] + ".vs.glsl";
 		const std::string fragment_shader_name = effect_paths[i] + ".fs.glsl";
 
-		bool is_valid = loadEffectFromFile(vertex_shader_name, fragment_shader_name, effects[i]);
+		bool is_valid = loadEffectFromFile(m_assets, vertex_shader_name, fragment_shader_name, effects[i]);
 		assert(is_valid && (GLuint)effects[i] != 0);
+
+		// Looked up once here, draws only read the cached values. Missing names stay -1.
+		const GLuint program = effects[i];
+		EffectLocations& locations = effect_locations[i];
+		locations.in_position = glGetAttribLocation(program, "in_position");
+		locations.in_texcoord = glGetAttribLocation(program, "in_texcoord");
+		locations.in_color = glGetAttribLocation(program, "in_color");
+		locations.in_transform = glGetAttribLocation(program, "in_transform");
+		locations.in_uv_rect = glGetAttribLocation(program, "in_uv_rect");
+		locations.projection = glGetUniformLocation(program, "projection");
+		locations.transform = glGetUniformLocation(program, "transform");
+		locations.fcolor = glGetUniformLocation(program, "fcolor");
+		locations.uv_rect = glGetUniformLocation(program, "uv_rect");
+		locations.time = glGetUniformLocation(program, "time");
+		locations.darken_screen_factor = glGetUniformLocation(program, "darken_screen_factor");
+		locations.light_up = glGetUniformLocation(program, "light_up");
+		locations.distort_on = glGetUniformLocation(program, "distort_on");
+		locations.shadow_on = glGetUniformLocation(program, "shadow_on");
+		locations.uv_scale = glGetUniformLocation(program, "uv_scale");
+		gl_has_errors();
 	}
 }
 
@@ -329,16 +546,17 @@ void RenderSystem::initializeGlEffects()
 template <class T>
 void RenderSystem::bindVBOandIBO(GEOMETRY_BUFFER_ID gid, std::vector<T> vertices, std::vector<uint16_t> indices)
 {
-	glBindBuffer(GL_ARRAY_BUFFER, vertex_buffers[(uint)gid]);
+	bindArrayBuffer(vertex_buffers[(uint)gid]);
 	glBufferData(GL_ARRAY_BUFFER,
 		sizeof(vertices[0]) * vertices.size(), vertices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffers[(uint)gid]);
+	bindElementBuffer(index_buffers[(uint)gid]);
     gl_has_errors();
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
 		sizeof(indices[0]) * indices.size(), indices.data(), GL_STATIC_DRAW);
 	gl_has_errors();
+	meshes[(uint)gid].num_indices = (unsigned int)indices.size();
 }
 
 void RenderSystem::initializeGlMeshes()
@@ -348,11 +566,29 @@ void RenderSystem::initializeGlMeshes()
 		// Initialize meshes
 		GEOMETRY_BUFFER_ID geom_index = mesh_paths[i].first;
 		std::string name = mesh_paths[i].second;
-		Mesh::loadFromOBJFile(name, 
-			meshes[(int)geom_index].vertices,
-			meshes[(int)geom_index].vertex_indices,
-            meshes[(int)geom_index].uv_indices,
-			meshes[(int)geom_index].original_size);
+		Mesh& mesh = meshes[(int)geom_index];
+		const AssetTocEntry* entry = m_assets.find(assetName(PROJECT_SOURCE_DIR, name));
+		AssetMeshHeader header;
+		if (entry != nullptr && m_assets.meshHeader(*entry, sizeof(TexturedVertex), header))
+		{
+			// Baked meshes are already in vertex buffer layout, no OBJ parsing
+			const unsigned char* blob = m_assets.data(*entry);
+			const TexturedVertex* vertices = (const TexturedVertex*)(blob + sizeof(header));
+			const uint16_t* vertex_indices = (const uint16_t*)(vertices + header.vertex_count);
+			const uint16_t* uv_indices = vertex_indices + header.vertex_index_count;
+			mesh.vertices.assign(vertices, vertices + header.vertex_count);
+			mesh.vertex_indices.assign(vertex_indices, vertex_indices + header.vertex_index_count);
+			mesh.uv_indices.assign(uv_indices, uv_indices + header.uv_index_count);
+			mesh.original_size = {header.original_size[0], header.original_size[1]};
+		}
+		else
+		{
+			Mesh::loadFromOBJFile(name,
+				mesh.vertices,
+				mesh.vertex_indices,
+				mesh.uv_indices,
+				mesh.original_size);
+		}
 
 		bindVBOandIBO(geom_index,
 			meshes[(int)geom_index].vertices, 
@@ -366,6 +602,9 @@ void RenderSystem::initializeGlGeometryBuffers()
 	glGenBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	// Index Buffer creation.
 	glGenBuffers((GLsizei)index_buffers.size(), index_buffers.data());
+	// Rings for the geometry rebuilt every frame: sprite instances, text, gestures, light
+	m_streamVertices.init(GL_ARRAY_BUFFER, STREAM_VERTEX_BYTES);
+	m_streamIndices.init(GL_ELEMENT_ARRAY_BUFFER, STREAM_INDEX_BYTES);
 
 	// Index and Vertex buffer data initialization.
 	initializeGlMeshes();
@@ -447,16 +686,13 @@ void RenderSystem::initializeGlGeometryBuffers()
 	const std::vector<uint16_t> screen_indices = { 0, 1, 2 };
 	bindVBOandIBO(GEOMETRY_BUFFER_ID::SCREEN_TRIANGLE, screen_vertices, screen_indices);
 
-    vec2 innerTopLeftCorner = vec2(window_width_px - 1175, window_height_px - 650);
-    vec2 innerTopRightCorner = vec2(window_width_px - 75, window_height_px - 650);
-    vec2 innerBottomLeftCorner = vec2(window_width_px - 1175, window_height_px - 100);
-    vec2 innerBottomRightCorner = vec2(window_width_px - 75, window_height_px - 100);
-
+	// The light darkens the whole room outside the visibility polygon, in world space
+	const vec2 room_size = m_roomTileDimensions * m_roomTileSize;
 	std::vector<vec3> shadow_vertices(4);
-    shadow_vertices[0] = { innerTopLeftCorner, 1.0f }; // Top-left
-    shadow_vertices[1] = { innerTopRightCorner, 1.0f }; // Top-right
-    shadow_vertices[2] = {  innerBottomRightCorner, 1.0f }; // Bottom-right
-    shadow_vertices[3] = { innerBottomLeftCorner, 1.0f }; // Bottom-left
+    shadow_vertices[0] = { 0.f, 0.f, 1.0f }; // Top-left
+    shadow_vertices[1] = { room_size.x, 0.f, 1.0f }; // Top-right
+    shadow_vertices[2] = { room_size.x, room_size.y, 1.0f }; // Bottom-right
+    shadow_vertices[3] = { 0.f, room_size.y, 1.0f }; // Bottom-left
 
 	// Counterclockwise as it's the default opengl front winding direction.
 	const std::vector<uint16_t> shadow_indices = { 0, 3, 2, 0, 2, 1};
@@ -465,12 +701,29 @@ void RenderSystem::initializeGlGeometryBuffers()
 
 RenderSystem::~RenderSystem()
 {
+	// Take the context back from the render thread, frames not yet drawn are dropped
+	if (m_renderThread.joinable()) {
+		m_frames.stop();
+		m_renderThread.join();
+		glfwMakeContextCurrent(window);
+	}
+
 	// Don't need to free gl resources since they last for as long as the program,
 	// but it's polite to clean after yourself.
 	glDeleteBuffers((GLsizei)vertex_buffers.size(), vertex_buffers.data());
 	glDeleteBuffers((GLsizei)index_buffers.size(), index_buffers.data());
-	glDeleteTextures((GLsizei)texture_gl_handles.size(), texture_gl_handles.data());
+	m_streamVertices.destroy();
+	m_streamIndices.destroy();
+	if (m_lightFanVBO != 0) {
+		glDeleteBuffers(1, &m_lightFanVBO);
+		glDeleteBuffers(1, &m_lightFanIBO);
+	}
+	clearWallChunks();
+	clearScreenTextures();
+	glDeleteTextures(1, &m_font_atlas);
+	glDeleteTextures((GLsizei)atlas_gl_handles.size(), atlas_gl_handles.data());
 	glDeleteTextures(1, &off_screen_render_buffer_color);
+	glDeleteQueries(FRAME_TIMER_QUERIES, m_frameTimerQueries);
 	glDeleteRenderbuffers(1, &off_screen_render_buffer_depth_stencil);
 	gl_has_errors();
 
@@ -493,6 +746,7 @@ bool RenderSystem::initScreenTexture()
 
 	int framebuffer_width, framebuffer_height;
 	glfwGetFramebufferSize(const_cast<GLFWwindow*>(window), &framebuffer_width, &framebuffer_height);  // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
+	m_screenTextureSize = ivec2(framebuffer_width, framebuffer_height);
 
 	glGenTextures(1, &off_screen_render_buffer_color);
 	glBindTexture(GL_TEXTURE_2D, off_screen_render_buffer_color);
@@ -537,25 +791,17 @@ bool gl_compile_shader(GLuint shader)
 	return true;
 }
 
-bool loadEffectFromFile(
+bool loadEffectFromFile(const AssetArchive& assets,
 	const std::string& vs_path, const std::string& fs_path, GLuint& out_program)
 {
-	// Opening files
-	std::ifstream vs_is(vs_path);
-	std::ifstream fs_is(fs_path);
-	if (!vs_is.good() || !fs_is.good())
+	// Reading sources
+	std::string vs_str, fs_str;
+	if (!readAssetText(assets, vs_path, vs_str) || !readAssetText(assets, fs_path, fs_str))
 	{
 		fprintf(stderr, "Failed to load shader files %s, %s", vs_path.c_str(), fs_path.c_str());
 		assert(false);
 		return false;
 	}
-
-	// Reading sources
-	std::stringstream vs_ss, fs_ss;
-	vs_ss << vs_is.rdbuf();
-	fs_ss << fs_is.rdbuf();
-	std::string vs_str = vs_ss.str();
-	std::string fs_str = fs_ss.str();
 	const char* vs_src = vs_str.c_str();
 	const char* fs_src = fs_str.c_str();
 	GLsizei vs_len = (GLsizei)vs_str.size();
@@ -617,31 +863,6 @@ bool loadEffectFromFile(
 }
 
 bool RenderSystem::initMainMenu(bool saveFileExists) {
-	int framebuffer_width, framebuffer_height;
-	glfwGetFramebufferSize(const_cast<GLFWwindow*>(window), &framebuffer_width, &framebuffer_height);  // Note, this will be 2x the resolution given to glfwCreateWindow on retina displays
-
-	glGenTextures(1, &mainMenuTexture);
-
-    ivec2 dimensions;
-
-    stbi_uc* data;
-    stbi_set_flip_vertically_on_load(true);
-    data = stbi_load(mainMenuImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-    if (data == NULL)
-    {
-        const std::string message = "Could not load the file " + mainMenuImgPath + ".";
-        fprintf(stderr, "%s", message.c_str());
-        assert(false);
-    }
-    glBindTexture(GL_TEXTURE_2D, mainMenuTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    gl_has_errors();
-    stbi_image_free(data);
-
-
     // Make menu buttons
     int mainMenuScreen = (int) SCREEN_ID::MAIN_MENU;
     createButton(vec2(window_width_px/2, 305), mainMenuScreen, (int)SCREEN_ID::GAME_SCREEN, (int)TEXTURE_ASSET_ID::CONTINUE_BUTTON, saveFileExists);
@@ -675,30 +896,6 @@ Entity RenderSystem::createButton(vec2 position, int screenTiedTo, int screenGoT
     return entity;
 }
 
-bool RenderSystem::initTutorial() {
-	glGenTextures(1, &tutorialTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(tutorialImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + tutorialImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, tutorialTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	gl_has_errors();
-	stbi_image_free(data);
-
-	return true;
-}
-
 Entity RenderSystem::createHoverEffect() {
     auto entity = Entity();
 
@@ -716,26 +913,6 @@ Entity RenderSystem::createHoverEffect() {
 }
 
 bool RenderSystem::initPauseMenu() {
-	glGenTextures(1, &pauseMenuTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(pauseMenuImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + pauseMenuImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, pauseMenuTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	gl_has_errors();
-	stbi_image_free(data);
-    //
     // Make menu buttons
     int pauseScreen = (int) SCREEN_ID::PAUSE_SCREEN;
     createButton(vec2(window_width_px/2, 305), pauseScreen, (int)SCREEN_ID::GAME_SCREEN, (int)TEXTURE_ASSET_ID::RESUME_BUTTON, false);
@@ -747,26 +924,6 @@ bool RenderSystem::initPauseMenu() {
 }
 
 bool RenderSystem::initDeathScreen() {
-	glGenTextures(1, &deathScreenTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(deathScreenImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + deathScreenImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, deathScreenTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	gl_has_errors();
-	stbi_image_free(data);
-    //
     // Make menu buttons
     int deathScreen = (int) SCREEN_ID::DEATH_SCREEN;
     createButton(vec2(window_width_px/2, 305), deathScreen, (int)SCREEN_ID::GAME_SCREEN, (int)TEXTURE_ASSET_ID::PLAY_AGAIN_BUTTON, false);
@@ -778,26 +935,6 @@ bool RenderSystem::initDeathScreen() {
 }
 
 bool RenderSystem::initWinScreen() {
-	glGenTextures(1, &winScreenTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(winScreenImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + winScreenImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, winScreenTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-	gl_has_errors();
-	stbi_image_free(data);
-    //
     // Make menu buttons
     int winScreen = (int) SCREEN_ID::WIN_SCREEN;
     createButton(vec2(window_width_px/2, 305), winScreen, (int)SCREEN_ID::GAME_SCREEN, (int)TEXTURE_ASSET_ID::PLAY_AGAIN_BUTTON, false);
@@ -807,76 +944,3 @@ bool RenderSystem::initWinScreen() {
 
 }
 
-bool RenderSystem::initGameBackground() {
-	glGenTextures(1, &gameBackgroundTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(gameBackgroundImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + gameBackgroundImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, gameBackgroundTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	gl_has_errors();
-	stbi_image_free(data);
-
-	return true;
-}
-
-bool RenderSystem::initFloor() {
-	glGenTextures(1, &floorTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(floorImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + floorImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, floorTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	gl_has_errors();
-	stbi_image_free(data);
-
-	return true;
-}
-
-bool RenderSystem::initSpaceship() {
-	glGenTextures(1, &spaceshipTexture);
-	
-	stbi_uc* data;
-	stbi_set_flip_vertically_on_load(true);
-	ivec2 dimensions;
-	data = stbi_load(spaceshipImgPath.c_str(), &dimensions.x, &dimensions.y, NULL, 4);
-
-	if (data == NULL)
-	{
-		const std::string message = "Could not load the file " + spaceshipImgPath + ".";
-		fprintf(stderr, "%s", message.c_str());
-		assert(false);
-	}
-	glBindTexture(GL_TEXTURE_2D, spaceshipTexture);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dimensions.x, dimensions.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-	gl_has_errors();
-	stbi_image_free(data);
-
-	return true;
-}
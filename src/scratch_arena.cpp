@@ -0,0 +1,60 @@
+#include "scratch_arena.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+
+void *ScratchArena::allocate(size_t size, size_t alignment)
+{
+    assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+    while (m_current < m_blocks.size())
+    {
+        Block &block = m_blocks[m_current];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t aligned = ((base + m_offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base;
+        if (aligned + size <= block.size)
+        {
+            m_used += aligned + size - m_offset;
+            m_offset = aligned + size;
+            return block.data.get() + aligned;
+        }
+        // The rest of this block is wasted until the next reset
+        m_used += block.size - m_offset;
+        m_current++;
+        m_offset = 0;
+    }
+
+    Block block;
+    block.size = std::max(m_blockSize, size + alignment);
+    block.data.reset(new char[block.size]);
+    m_blocks.push_back(std::move(block));
+    m_current = m_blocks.size() - 1;
+    m_offset = 0;
+    return allocate(size, alignment);
+}
+
+void ScratchArena::reset()
+{
+    // A frame that overflowed gets one block big enough for all of it next time
+    if (m_blocks.size() > 1)
+    {
+        size_t total = capacity();
+        m_blocks.clear();
+        Block block;
+        block.size = total;
+        block.data.reset(new char[total]);
+        m_blocks.push_back(std::move(block));
+        m_blockSize = std::max(m_blockSize, total);
+    }
+    m_current = 0;
+    m_offset = 0;
+    m_used = 0;
+}
+
+size_t ScratchArena::capacity() const
+{
+    size_t total = 0;
+    for (const Block &block : m_blocks)
+        total += block.size;
+    return total;
+}
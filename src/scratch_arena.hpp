@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Bump allocator for per frame scratch data. Allocations are never freed one by one,
+// reset() releases everything at once. After the first few frames the arena holds a
+// single block big enough for a whole frame, so steady state frames never touch the heap.
+class ScratchArena
+{
+public:
+    explicit ScratchArena(size_t block_size = 64 * 1024) : m_blockSize(block_size) {}
+    ScratchArena(const ScratchArena &) = delete;
+    ScratchArena &operator=(const ScratchArena &) = delete;
+
+    void *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialized storage for count T's, only for types that need no destructor
+    template <typename T>
+    T *allocateArray(size_t count)
+    {
+        return static_cast<T *>(allocate(sizeof(T) * count, alignof(T)));
+    }
+
+    // Everything allocated since the last reset is gone after this
+    void reset();
+
+    size_t used() const { return m_used; }
+    size_t capacity() const;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t m_blockSize;
+    std::vector<Block> m_blocks;
+    size_t m_current = 0; // block being bumped
+    size_t m_offset = 0;  // into m_blocks[m_current]
+    size_t m_used = 0;    // bytes handed out since reset, including padding
+};
+
+// Lets standard containers take their nodes from an arena. Deallocation does nothing,
+// the memory comes back with the arena's reset, so a container using this must not
+// outlive the frame it was filled in.
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+
+    explicit ArenaAllocator(ScratchArena *arena) : m_arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : m_arena(other.arena()) {}
+
+    T *allocate(size_t count) { return m_arena->allocateArray<T>(count); }
+    void deallocate(T *, size_t) {}
+
+    ScratchArena *arena() const { return m_arena; }
+
+private:
+    ScratchArena *m_arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b)
+{
+    return !(a == b);
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <climits>
+#include <future>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "thread_pool.hpp"
+
+struct SeedRaceStats
+{
+    int seed = 0;                     // lowest seed that succeeded
+    unsigned int attempts = 0;        // attempts run, including ones a lower seed beat
+    unsigned int serial_attempts = 0; // what trying one seed after the other would have run
+};
+
+// Runs attempt(seed, result) for consecutive seeds from first_seed on every worker of
+// the pool and keeps the result of the lowest seed that succeeded, the same one a serial
+// retry loop would stop at. Workers take seeds in increasing order and stop once the next
+// seed is past a success, so nothing is started that could no longer win. An attempt
+// already running when a lower seed succeeds finishes and is dropped.
+// Never returns if no seed succeeds, like the loop it replaces.
+template <class Result, class Attempt>
+SeedRaceStats raceSeeds(ThreadPool &pool, int first_seed, const Attempt &attempt, Result &out)
+{
+    std::atomic<unsigned int> next_offset(0);
+    std::atomic<unsigned int> winner(UINT_MAX);
+    std::atomic<unsigned int> attempts(0);
+    std::mutex out_mutex;
+
+    auto worker = [&]() {
+        Result result;
+        for (;;)
+        {
+            const unsigned int offset = next_offset++;
+            if (offset >= winner.load())
+                return;
+            attempts++;
+            // Wrap around instead of overflowing the int
+            const int seed = (int)((unsigned int)first_seed + offset);
+            if (!attempt(seed, result))
+                continue;
+
+            std::lock_guard<std::mutex> lock(out_mutex);
+            if (offset < winner.load())
+            {
+                out = std::move(result);
+                winner = offset;
+            }
+            // Every seed this worker could take next is higher
+            return;
+        }
+    };
+
+    std::vector<std::future<void>> jobs;
+    for (unsigned int i = 0; i < pool.size(); i++)
+        jobs.push_back(pool.submit(worker));
+    for (std::future<void> &job : jobs)
+        job.get();
+
+    SeedRaceStats stats;
+    stats.seed = (int)((unsigned int)first_seed + winner.load());
+    stats.attempts = attempts.load();
+    stats.serial_attempts = winner.load() + 1;
+    return stats;
+}
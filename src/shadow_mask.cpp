@@ -0,0 +1,151 @@
+#include "shadow_mask.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+constexpr float ShadowMask::SHADOW_ALPHA;
+
+void ShadowMask::resize(int width, int height, glm::vec2 world_min, glm::vec2 world_max)
+{
+    m_width = std::max(1, width);
+    m_height = std::max(1, height);
+    m_worldMin = world_min;
+    m_worldMax = world_max;
+    m_pixels.assign(m_width * m_height, 0);
+    m_coverage.assign(m_width * m_height, 0.f);
+}
+
+void ShadowMask::rasterize(const std::vector<glm::vec2> &polygon)
+{
+    rasterize(std::vector<const std::vector<glm::vec2> *>{&polygon});
+}
+
+void ShadowMask::rasterize(const std::vector<const std::vector<glm::vec2> *> &polygons)
+{
+    std::fill(m_coverage.begin(), m_coverage.end(), 0.f);
+
+    // Work in pixel units
+    const glm::vec2 scale = glm::vec2(m_width, m_height) / (m_worldMax - m_worldMin);
+    const float row_weight = 1.f / SUBSAMPLES;
+
+    for (int y = 0; y < m_height; y++)
+    {
+        float *row = &m_coverage[y * m_width];
+        for (int s = 0; s < SUBSAMPLES; s++)
+        {
+            const float sample_y = y + (s + 0.5f) * row_weight;
+
+            // Spans between pairs of crossings are inside each polygon
+            m_spans.clear();
+            for (const std::vector<glm::vec2> *polygon : polygons)
+            {
+                const size_t n = polygon->size();
+                if (n < 3)
+                    continue;
+                // Where the polygon's edges cross this sample line, half open so shared vertices count once
+                m_crossings.clear();
+                for (size_t i = 0; i < n; i++)
+                {
+                    glm::vec2 a = ((*polygon)[i] - m_worldMin) * scale;
+                    glm::vec2 b = ((*polygon)[(i + 1) % n] - m_worldMin) * scale;
+                    if ((a.y <= sample_y) == (b.y <= sample_y))
+                        continue;
+                    m_crossings.push_back(a.x + (sample_y - a.y) / (b.y - a.y) * (b.x - a.x));
+                }
+                std::sort(m_crossings.begin(), m_crossings.end());
+                for (size_t i = 0; i + 1 < m_crossings.size(); i += 2)
+                    m_spans.push_back(glm::vec2(m_crossings[i], m_crossings[i + 1]));
+            }
+
+            // Overlapping spans of different polygons are merged so nothing is lit twice
+            std::sort(m_spans.begin(), m_spans.end(), [](glm::vec2 a, glm::vec2 b) { return a.x < b.x; });
+            size_t merged = 0;
+            for (size_t i = 0; i < m_spans.size(); i++)
+            {
+                if (merged > 0 && m_spans[i].x <= m_spans[merged - 1].y)
+                    m_spans[merged - 1].y = std::max(m_spans[merged - 1].y, m_spans[i].y);
+                else
+                    m_spans[merged++] = m_spans[i];
+            }
+
+            // Pixels get the part of the span they hold
+            for (size_t i = 0; i < merged; i++)
+            {
+                float x0 = std::max(0.f, m_spans[i].x);
+                float x1 = std::min((float)m_width, m_spans[i].y);
+                if (x1 <= x0)
+                    continue;
+                int first = (int)std::floor(x0);
+                int last = std::min(m_width - 1, (int)std::floor(x1));
+                if (first == last)
+                {
+                    row[first] += (x1 - x0) * row_weight;
+                    continue;
+                }
+                row[first] += (first + 1 - x0) * row_weight;
+                for (int x = first + 1; x < last; x++)
+                    row[x] += row_weight;
+                row[last] += (x1 - last) * row_weight;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < m_pixels.size(); i++)
+    {
+        float shadow = SHADOW_ALPHA * (1.f - std::min(1.f, m_coverage[i]));
+        m_pixels[i] = (unsigned char)std::lround(shadow * 255.f);
+    }
+}
+
+bool ShadowMask::writePGM(const std::string &path) const
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        fprintf(stderr, "Could not open %s for writing\n", path.c_str());
+        return false;
+    }
+    fprintf(file, "P5\n%d %d\n255\n", m_width, m_height);
+    bool ok = fwrite(m_pixels.data(), 1, m_pixels.size(), file) == m_pixels.size();
+    ok = (fclose(file) == 0) && ok;
+    if (!ok)
+        fprintf(stderr, "Failed writing %s\n", path.c_str());
+    return ok;
+}
+
+bool ShadowMask::readPGM(const std::string &path)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+        return false;
+    int width, height, max_value;
+    // Only what writePGM produces: no comments, 8 bit
+    bool ok = fscanf(file, "P5 %d %d %d", &width, &height, &max_value) == 3 && max_value == 255 &&
+              width > 0 && height > 0 && fgetc(file) != EOF;
+    if (ok)
+    {
+        m_width = width;
+        m_height = height;
+        m_pixels.resize(width * height);
+        m_coverage.assign(width * height, 0.f);
+        ok = fread(m_pixels.data(), 1, m_pixels.size(), file) == m_pixels.size();
+    }
+    fclose(file);
+    if (!ok)
+        fprintf(stderr, "%s is not a shadow mask\n", path.c_str());
+    return ok;
+}
+
+float ShadowMask::difference(const ShadowMask &a, const ShadowMask &b)
+{
+    if (a.m_width != b.m_width || a.m_height != b.m_height)
+        return -1.f;
+    if (a.m_pixels.empty())
+        return 0.f;
+    long long total = 0;
+    for (size_t i = 0; i < a.m_pixels.size(); i++)
+        total += std::abs((int)a.m_pixels[i] - (int)b.m_pixels[i]);
+    return (float)total / a.m_pixels.size();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+// Low resolution software version of what lightScreen draws: a shadow plane over a world
+// rectangle with the visibility polygon cut out of it. Each pixel stores the shadow
+// opacity the light shader would blend, scaled by how much of the pixel the polygon
+// leaves uncovered, so images of the same scene can be compared without a GPU.
+class ShadowMask
+{
+public:
+    // Opacity of the shadow plane in light.fs.glsl
+    static constexpr float SHADOW_ALPHA = 0.2f;
+
+    void resize(int width, int height, glm::vec2 world_min, glm::vec2 world_max);
+
+    // Any simple polygon in world space, even-odd filled. Coverage is exact along x
+    // and sampled SUBSAMPLES times per pixel along y.
+    void rasterize(const std::vector<glm::vec2> &polygon);
+    // The union of several polygons, one per light
+    void rasterize(const std::vector<const std::vector<glm::vec2> *> &polygons);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    // 0 for fully lit, 255 for full shadow opacity
+    unsigned char at(int x, int y) const { return m_pixels[y * m_width + x]; }
+    const std::vector<unsigned char> &pixels() const { return m_pixels; }
+
+    // Binary 8 bit greyscale, readable by most image tools
+    bool writePGM(const std::string &path) const;
+    bool readPGM(const std::string &path);
+
+    // Mean absolute per pixel difference in [0, 255], -1 when the sizes differ
+    static float difference(const ShadowMask &a, const ShadowMask &b);
+
+private:
+    static const int SUBSAMPLES = 4;
+
+    int m_width = 0;
+    int m_height = 0;
+    glm::vec2 m_worldMin = glm::vec2(0.f);
+    glm::vec2 m_worldMax = glm::vec2(1.f);
+    std::vector<unsigned char> m_pixels;
+    std::vector<float> m_coverage; // lit fraction per pixel while rasterizing
+    std::vector<float> m_crossings;
+    std::vector<glm::vec2> m_spans; // inside intervals of one sample line, x to y
+};
@@ -0,0 +1,48 @@
+#include "sprite_batch.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+bool SpriteBatchKey::operator<(const SpriteBatchKey &other) const
+{
+    return std::tie(layer, effect, texture, geometry) <
+           std::tie(other.layer, other.effect, other.texture, other.geometry);
+}
+
+bool SpriteBatchKey::operator==(const SpriteBatchKey &other) const
+{
+    return layer == other.layer && effect == other.effect &&
+           texture == other.texture && geometry == other.geometry;
+}
+
+void SpriteBatchBuilder::clear()
+{
+    // Keeps the capacity, so a steady frame does not allocate
+    m_entries.clear();
+    m_instances.clear();
+    m_sortedInstances.clear();
+    m_batches.clear();
+}
+
+void SpriteBatchBuilder::add(const SpriteBatchKey &key, const SpriteInstance &instance)
+{
+    m_entries.push_back({key, (unsigned int)m_instances.size()});
+    m_instances.push_back(instance);
+}
+
+void SpriteBatchBuilder::build()
+{
+    std::stable_sort(m_entries.begin(), m_entries.end(),
+                     [](const Entry &a, const Entry &b) { return a.key < b.key; });
+
+    m_sortedInstances.clear();
+    m_batches.clear();
+    for (const Entry &entry : m_entries)
+    {
+        if (m_batches.empty() || !(m_batches.back().key == entry.key))
+            m_batches.push_back({entry.key, (unsigned int)m_sortedInstances.size(), 0});
+
+        m_sortedInstances.push_back(m_instances[entry.index]);
+        m_batches.back().instance_count++;
+    }
+}
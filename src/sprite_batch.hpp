@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+// Only glm is used here so the batch builder can be used without a GL context
+#include <glm/vec3.hpp>
+#include <glm/vec4.hpp>
+#include <glm/mat3x3.hpp>
+
+// Per-instance data streamed to the textured_instanced shader
+struct SpriteInstance
+{
+    glm::mat3 transform;
+    glm::vec3 color;
+    glm::vec4 uv_rect; // offset (xy) and size (zw) applied to the mesh texcoords
+};
+
+// Sprites sharing a key are drawn with one instanced draw call.
+// The layer is compared first so that sorting keeps the draw order between layers.
+struct SpriteBatchKey
+{
+    unsigned int layer;
+    unsigned int effect;
+    unsigned int texture;
+    unsigned int geometry;
+
+    bool operator<(const SpriteBatchKey &other) const;
+    bool operator==(const SpriteBatchKey &other) const;
+};
+
+struct SpriteBatch
+{
+    SpriteBatchKey key;
+    unsigned int first_instance;
+    unsigned int instance_count;
+};
+
+// Collects the sprites of a pass and groups them into batches, makes no GL calls
+class SpriteBatchBuilder
+{
+public:
+    void clear();
+    void add(const SpriteBatchKey &key, const SpriteInstance &instance);
+
+    // Sort the added sprites by key (stable, so submission order is kept within a batch)
+    // and fill instances() with one contiguous run per entry of batches()
+    void build();
+
+    const std::vector<SpriteInstance> &instances() const { return m_sortedInstances; }
+    const std::vector<SpriteBatch> &batches() const { return m_batches; }
+
+private:
+    struct Entry
+    {
+        SpriteBatchKey key;
+        unsigned int index;
+    };
+
+    std::vector<Entry> m_entries;
+    std::vector<SpriteInstance> m_instances;
+    std::vector<SpriteInstance> m_sortedInstances;
+    std::vector<SpriteBatch> m_batches;
+};
@@ -0,0 +1,58 @@
+#include "stream_buffer.hpp"
+
+#include <cstring>
+
+void StreamBuffer::init(GLenum target, size_t capacity)
+{
+    m_target = target;
+    m_capacity = capacity;
+    m_head = 0;
+    m_allocated = false;
+    glGenBuffers(1, &m_buffer);
+}
+
+void StreamBuffer::destroy()
+{
+    if (m_buffer != 0)
+        glDeleteBuffers(1, &m_buffer);
+    m_buffer = 0;
+    m_allocated = false;
+}
+
+size_t StreamBuffer::push(const void *data, size_t size, bool &orphaned)
+{
+    orphaned = false;
+    size_t offset = (m_head + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size == 0)
+        return offset;
+
+    // A single push bigger than the ring grows it, the old storage goes with the orphaning
+    if (size > m_capacity)
+    {
+        while (m_capacity < size)
+            m_capacity *= 2;
+        m_allocated = false;
+    }
+    if (!m_allocated || offset + size > m_capacity)
+    {
+        glBufferData(m_target, (GLsizeiptr)m_capacity, nullptr, GL_STREAM_DRAW);
+        m_allocated = true;
+        orphaned = true;
+        offset = 0;
+    }
+
+    void *dst = glMapBufferRange(m_target, (GLintptr)offset, (GLsizeiptr)size,
+                                 GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (dst != nullptr)
+    {
+        memcpy(dst, data, size);
+        glUnmapBuffer(m_target);
+    }
+    else
+    {
+        // Some drivers refuse to map, the range is still unused so a plain upload is fine
+        glBufferSubData(m_target, (GLintptr)offset, (GLsizeiptr)size, data);
+    }
+    m_head = offset + size;
+    return offset;
+}
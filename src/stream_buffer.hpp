@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstddef>
+
+#include <gl3w.h>
+
+// Ring of buffer memory that per-frame geometry is suballocated from.
+// Each push maps only the bytes it writes, unsynchronized, which is safe because nothing
+// behind the head is written again before the storage is replaced. When the ring is full
+// the storage is orphaned: the driver keeps the old block alive for draws still in flight
+// and hands back a fresh one, so neither side waits and no buffer names are created.
+// Persistent mapping would need GL 4.4 (glBufferStorage), the game asks for a 3.3 context.
+class StreamBuffer
+{
+public:
+    // Offsets handed out are aligned to this, enough for any vertex or index type we stream
+    static const size_t ALIGNMENT = 16;
+
+    // Storage is allocated on the first push
+    void init(GLenum target, size_t capacity);
+    void destroy();
+
+    GLuint buffer() const { return m_buffer; }
+    size_t capacity() const { return m_capacity; }
+
+    // The buffer must already be bound to the target. Copies size bytes into the ring and
+    // returns their byte offset in the buffer. orphaned is set when the storage was replaced.
+    size_t push(const void *data, size_t size, bool &orphaned);
+
+private:
+    GLenum m_target = 0;
+    GLuint m_buffer = 0;
+    size_t m_capacity = 0;
+    size_t m_head = 0;
+    bool m_allocated = false;
+};
@@ -0,0 +1,89 @@
+#include "texture_atlas.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+bool packAtlas(const std::vector<glm::ivec2> &sizes, int max_size, int padding, AtlasLayout &out)
+{
+    out.placements.assign(sizes.size(), {0, 0, 0});
+    out.page_sizes.clear();
+
+    // Tallest first keeps the rows tight
+    std::vector<size_t> order(sizes.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&sizes](size_t a, size_t b) { return sizes[a].y > sizes[b].y; });
+
+    int page = -1;
+    int cursor_x = 0;
+    int shelf_y = 0;
+    int shelf_height = 0;
+
+    for (size_t i : order)
+    {
+        int w = sizes[i].x + 2 * padding;
+        int h = sizes[i].y + 2 * padding;
+        if (w > max_size || h > max_size)
+            return false;
+
+        // Next row, then next page, when the image does not fit
+        if (page >= 0 && cursor_x + w > max_size)
+        {
+            shelf_y += shelf_height;
+            cursor_x = 0;
+            shelf_height = 0;
+        }
+        if (page < 0 || shelf_y + h > max_size)
+        {
+            page++;
+            out.page_sizes.push_back(glm::ivec2(0));
+            cursor_x = 0;
+            shelf_y = 0;
+            shelf_height = 0;
+        }
+
+        out.placements[i] = {page, cursor_x + padding, shelf_y + padding};
+        cursor_x += w;
+        shelf_height = std::max(shelf_height, h);
+
+        glm::ivec2 &page_size = out.page_sizes[page];
+        page_size.x = std::max(page_size.x, cursor_x);
+        page_size.y = std::max(page_size.y, shelf_y + shelf_height);
+    }
+    return true;
+}
+
+glm::vec4 atlasUVRect(const AtlasPlacement &placement, glm::ivec2 size, glm::ivec2 page_size)
+{
+    return glm::vec4(float(placement.x) / page_size.x, float(placement.y) / page_size.y,
+                     float(size.x) / page_size.x, float(size.y) / page_size.y);
+}
+
+glm::vec4 atlasSubRect(const glm::vec4 &region, const glm::vec4 &local)
+{
+    return glm::vec4(region.x + local.x * region.z, region.y + local.y * region.w,
+                     local.z * region.z, local.w * region.w);
+}
+
+void blitIntoAtlas(std::vector<unsigned char> &page_pixels, glm::ivec2 page_size,
+                   const unsigned char *rgba, glm::ivec2 size, const AtlasPlacement &placement, int padding)
+{
+    for (int y = -padding; y < size.y + padding; y++)
+    {
+        int src_y = std::min(size.y - 1, std::max(0, y));
+        int dst_y = placement.y + y;
+        if (dst_y < 0 || dst_y >= page_size.y)
+            continue;
+
+        for (int x = -padding; x < size.x + padding; x++)
+        {
+            int src_x = std::min(size.x - 1, std::max(0, x));
+            int dst_x = placement.x + x;
+            if (dst_x < 0 || dst_x >= page_size.x)
+                continue;
+
+            memcpy(&page_pixels[(dst_y * page_size.x + dst_x) * 4], &rgba[(src_y * size.x + src_x) * 4], 4);
+        }
+    }
+}
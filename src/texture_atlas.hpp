@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/ext/vector_int2.hpp>
+#include <glm/vec4.hpp>
+
+// Where one image ended up: the page index and its lower left pixel in that page
+struct AtlasPlacement
+{
+    int page;
+    int x;
+    int y;
+};
+
+struct AtlasLayout
+{
+    std::vector<AtlasPlacement> placements; // same order as the sizes passed to packAtlas
+    std::vector<glm::ivec2> page_sizes;
+};
+
+// Shelf packer: images are sorted by height and placed left to right in rows,
+// starting a new page when a page of max_size x max_size is full.
+// padding pixels are kept free around every image for edge extrusion.
+// Returns false if an image is larger than a page.
+bool packAtlas(const std::vector<glm::ivec2> &sizes, int max_size, int padding, AtlasLayout &out);
+
+// UV rectangle, offset (xy) and size (zw), of an image of the given size placed in a page
+glm::vec4 atlasUVRect(const AtlasPlacement &placement, glm::ivec2 size, glm::ivec2 page_size);
+
+// Maps a rectangle given in the image's own UV space (e.g. one sprite sheet frame) into the atlas
+glm::vec4 atlasSubRect(const glm::vec4 &region, const glm::vec4 &local);
+
+// Copies an RGBA image into a page and repeats its border pixels into the padding,
+// so nearest sampling right at the edge of the image never picks up a neighbour
+void blitIntoAtlas(std::vector<unsigned char> &page_pixels, glm::ivec2 page_size,
+                   const unsigned char *rgba, glm::ivec2 size, const AtlasPlacement &placement, int padding);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads pulling jobs off one queue.
+// Jobs must not touch GL, the context only lives on the render thread.
+class ThreadPool
+{
+public:
+    // 0 picks one thread per hardware thread minus the main thread, at least one
+    explicit ThreadPool(unsigned thread_count = 0);
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+    // Runs whatever is still queued, then joins
+    ~ThreadPool();
+
+    template <class F>
+    auto submit(F &&job) -> std::future<decltype(job())>
+    {
+        using Result = decltype(job());
+        // std::function needs a copyable target, packaged_task is move only
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.emplace_back([task]() { (*task)(); });
+        }
+        m_wake.notify_one();
+        return result;
+    }
+
+    unsigned size() const { return (unsigned)m_workers.size(); }
+
+private:
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void()>> m_jobs;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stopping = false;
+};
@@ -8,6 +8,7 @@
 #include <functional>
 #include <typeindex>
 #include <assert.h>
+#include <cstdint>
 
 // Unique identifyer for all entities
 class Entity
@@ -37,6 +38,29 @@ struct ContainerInterface
 	virtual size_t size() = 0;
 	virtual void remove(Entity e) = 0;
 	virtual bool has(Entity entity) = 0;
+
+	// Set by the registry: the shared entity -> component signature map and this container's bit in it
+	std::unordered_map<unsigned int, uint64_t>* signatures = nullptr;
+	uint64_t signature_bit = 0;
+
+protected:
+	void mark_signature(Entity e)
+	{
+		if (signatures)
+			(*signatures)[e] |= signature_bit;
+	}
+
+	void unmark_signature(Entity e)
+	{
+		if (!signatures)
+			return;
+		auto it = signatures->find(e);
+		if (it == signatures->end())
+			return;
+		it->second &= ~signature_bit;
+		if (it->second == 0)
+			signatures->erase(it);
+	}
 };
 
 // A container that stores components of type 'Component' and associated entities
@@ -68,6 +92,7 @@ public:
 		map_entity_componentID[e] = (unsigned int)components.size();
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
+		mark_signature(e);
 		return components.back();
 	};
 
@@ -80,6 +105,7 @@ public:
 		map_entity_componentID[e] = (unsigned int)components.size();
 		components.push_back(std::move(c)); // the move enforces move instead of copy constructor
 		entities.push_back(e);
+		mark_signature(e);
 	};
 	// The emplace function takes the the provided arguments Args, creates a new object of type Component, and inserts it into the ECS system
 	template<typename... Args>
@@ -120,6 +146,7 @@ public:
 			map_entity_componentID.erase(e);
 			components.pop_back();
 			entities.pop_back();
+			unmark_signature(e);
 			// Note, one could mark the id for re-use
 		}
 	};
@@ -127,11 +154,21 @@ public:
 	// Remove all components of type 'Component'
 	void clear()
 	{
+		for (Entity e : entities)
+			unmark_signature(e);
 		map_entity_componentID.clear();
 		components.clear();
 		entities.clear();
 	}
 
+	// Pre-allocate storage for n components so that inserting up to n does not reallocate
+	void reserve(size_t n)
+	{
+		map_entity_componentID.reserve(n);
+		components.reserve(n);
+		entities.reserve(n);
+	}
+
 	// Report the number of components of type 'Component'
 	size_t size()
 	{
@@ -11,6 +11,21 @@ class ECSRegistry
     // Callbacks to remove a particular or all entities in the system
     std::vector<ContainerInterface *> registry_list;
 
+    // Bitmask per entity of the containers (by index in registry_list) it has a component in
+    std::unordered_map<unsigned int, uint64_t> signatures;
+
+    // Structural changes recorded while systems iterate containers, applied in flush_deferred
+    std::vector<std::function<void()>> deferred_commands;
+    std::vector<Entity> deferred_removals;
+
+    void register_container(ContainerInterface *container)
+    {
+        assert(registry_list.size() < 64 && "Component signature only has 64 bits");
+        container->signatures = &signatures;
+        container->signature_bit = uint64_t(1) << registry_list.size();
+        registry_list.push_back(container);
+    }
+
 public:
     // Manually created list of all components this game has
     // TODO: A1 add a LightUp component
@@ -35,7 +50,6 @@ public:
     ComponentContainer<MeleeAttack> meleeAttacks;
     ComponentContainer<DamageEffect> damageEffect;
     ComponentContainer<Animation> animations;
-    ComponentContainer<HealthBar> healthBars;
     ComponentContainer<Boss> bosses;
     ComponentContainer<Text> texts;
     ComponentContainer<Teleporter> teleporters;
@@ -55,47 +69,49 @@ public:
     // IMPORTANT: Don't forget to add any newly added containers!
     ECSRegistry()
     {
-        registry_list.push_back(&deathTimers);
-        registry_list.push_back(&motions);
-        registry_list.push_back(&collisions);
-        registry_list.push_back(&players);
-        registry_list.push_back(&meshPtrs);
-        registry_list.push_back(&renderRequests);
-        registry_list.push_back(&screenStates);
-        registry_list.push_back(&enemies);
-        registry_list.push_back(&debugComponents);
-        registry_list.push_back(&colors);
-        registry_list.push_back(&projectiles);
-        registry_list.push_back(&walls);
-        registry_list.push_back(&reloadTimes);
-        registry_list.push_back(&lightOfSight);
-        registry_list.push_back(&dashes);
-        registry_list.push_back(&healths);
-        registry_list.push_back(&powerUps);
-        registry_list.push_back(&clickables);
-        registry_list.push_back(&meleeAttacks);
-        registry_list.push_back(&damageEffect);
-        registry_list.push_back(&animations);
-        registry_list.push_back(&healthBars);
-        registry_list.push_back(&bosses);
-        registry_list.push_back(&texts);
-        registry_list.push_back(&teleporters);
-        registry_list.push_back(&teleporting);
-        registry_list.push_back(&lights);
-        registry_list.push_back(&necromancers);
-        registry_list.push_back(&wallMotions);
-        registry_list.push_back(&enemyMotions);
-        registry_list.push_back(&projectileMotions);
-        registry_list.push_back(&gridMaps);
-        registry_list.push_back(&pathfinders);
-        registry_list.push_back(&lightUps);
-        registry_list.push_back(&exposedWallMotions);
+        register_container(&deathTimers);
+        register_container(&motions);
+        register_container(&collisions);
+        register_container(&players);
+        register_container(&meshPtrs);
+        register_container(&renderRequests);
+        register_container(&screenStates);
+        register_container(&enemies);
+        register_container(&debugComponents);
+        register_container(&colors);
+        register_container(&projectiles);
+        register_container(&walls);
+        register_container(&reloadTimes);
+        register_container(&lightOfSight);
+        register_container(&dashes);
+        register_container(&healths);
+        register_container(&powerUps);
+        register_container(&clickables);
+        register_container(&meleeAttacks);
+        register_container(&damageEffect);
+        register_container(&animations);
+        register_container(&bosses);
+        register_container(&texts);
+        register_container(&teleporters);
+        register_container(&teleporting);
+        register_container(&lights);
+        register_container(&necromancers);
+        register_container(&wallMotions);
+        register_container(&enemyMotions);
+        register_container(&projectileMotions);
+        register_container(&gridMaps);
+        register_container(&pathfinders);
+        register_container(&lightUps);
+        register_container(&exposedWallMotions);
     }
 
     void clear_all_components()
     {
         for (ContainerInterface *reg : registry_list)
             reg->clear();
+        signatures.clear();
+        deferred_commands.clear();
+        deferred_removals.clear();
     }
 
     void list_all_components()
@@ -114,10 +130,46 @@ public:
                 printf("type %s\n", typeid(*reg).name());
     }
 
+    // Only visits the containers named in the entity's signature
     void remove_all_components_of(Entity e)
     {
-        for (ContainerInterface *reg : registry_list)
-            reg->remove(e);
+        auto it = signatures.find(e);
+        if (it == signatures.end())
+            return;
+
+        // copy, as each remove clears its bit in the map
+        uint64_t signature = it->second;
+        for (size_t i = 0; signature != 0; i++, signature >>= 1)
+            if (signature & 1)
+                registry_list[i]->remove(e);
+    }
+
+    // defer and defer_remove_all_components_of are safe to call while iterating any container.
+    // Nothing changes until the next flush_deferred.
+
+    // Run a command at the next flush, e.g. a create* factory call
+    void defer(std::function<void()> command)
+    {
+        deferred_commands.push_back(std::move(command));
+    }
+
+    void defer_remove_all_components_of(Entity e)
+    {
+        deferred_removals.push_back(e);
+    }
+
+    // Sync point: called by the main loop between systems.
+    // Commands run in the order recorded, then the queued entities are destroyed.
+    void flush_deferred()
+    {
+        // commands may record further commands, so index rather than iterate
+        for (size_t i = 0; i < deferred_commands.size(); i++)
+            deferred_commands[i]();
+        deferred_commands.clear();
+
+        for (Entity e : deferred_removals)
+            remove_all_components_of(e);
+        deferred_removals.clear();
     }
 };
 
@@ -0,0 +1,147 @@
+#include "visibility.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <glm/common.hpp>
+#include <glm/geometric.hpp>
+
+static const unsigned int NO_EDGE = ~0u;
+
+static float cross(glm::vec2 a, glm::vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+// 0 along +x, increasing counterclockwise to just under 4. Sorts like atan2 without the trig.
+static float pseudoAngle(glm::vec2 d)
+{
+    float p = d.x / (std::fabs(d.x) + std::fabs(d.y));
+    return d.y < 0.f ? 3.f + p : 1.f - p;
+}
+
+// Which side of the edge's line p is on, positive is the origin's side since edges run
+// counterclockwise. 0 when p is within a thousandth of a pixel of the line.
+static int sideOf(glm::vec2 begin, glm::vec2 end, glm::vec2 p)
+{
+    glm::vec2 d = end - begin;
+    float side = cross(d, p - begin);
+    if (side * side <= 1e-6f * glm::dot(d, d))
+        return 0;
+    return side > 0.f ? 1 : -1;
+}
+
+bool VisibilitySweep::CloserToOrigin::operator()(unsigned int lhs, unsigned int rhs) const
+{
+    if (lhs == rhs)
+        return false;
+    const Edge &a = (*edges)[lhs];
+    const Edge &b = (*edges)[rhs];
+
+    // a is closer if it lies on the origin's side of b's line...
+    int a_begin = sideOf(b.begin, b.end, a.begin);
+    int a_end = sideOf(b.begin, b.end, a.end);
+    if (a_begin >= 0 && a_end >= 0 && (a_begin | a_end) != 0)
+        return true;
+    // ...or b lies beyond a's line
+    int b_begin = sideOf(a.begin, a.end, b.begin);
+    int b_end = sideOf(a.begin, a.end, b.end);
+    return b_begin <= 0 && b_end <= 0 && (b_begin | b_end) != 0;
+}
+
+void VisibilitySweep::addEdge(glm::vec2 a, glm::vec2 b)
+{
+    // Edges pointing at the origin hide nothing
+    float winding = cross(a, b);
+    if (winding * winding <= 1e-6f * glm::dot(b - a, b - a))
+        return;
+    if (winding < 0.f)
+        std::swap(a, b);
+    m_edges.push_back({a, b});
+}
+
+glm::vec2 VisibilitySweep::hitAlong(glm::vec2 direction, unsigned int edge) const
+{
+    const Edge &e = m_edges[edge];
+    glm::vec2 d = e.end - e.begin;
+    float denom = cross(direction, d);
+    if (std::fabs(denom) < 1e-12f)
+        return glm::dot(e.begin, e.begin) < glm::dot(e.end, e.end) ? e.begin : e.end;
+    return direction * (cross(e.begin, d) / denom);
+}
+
+void VisibilitySweep::compute(glm::vec2 origin, const std::vector<VisibilitySegment> &segments,
+                              glm::vec2 bounds_min, glm::vec2 bounds_max, std::vector<glm::vec2> &out_polygon)
+{
+    out_polygon.clear();
+    origin = glm::clamp(origin, bounds_min + 0.5f, bounds_max - 0.5f);
+
+    // The bounds close the polygon, every ray hits at least one of them
+    m_edges.clear();
+    glm::vec2 corners[4] = {bounds_min, {bounds_max.x, bounds_min.y}, bounds_max, {bounds_min.x, bounds_max.y}};
+    for (int i = 0; i < 4; i++)
+        addEdge(corners[i] - origin, corners[(i + 1) % 4] - origin);
+    for (const VisibilitySegment &segment : segments)
+        addEdge(segment.a - origin, segment.b - origin);
+
+    // The set of the last call is gone, its nodes can be handed out again
+    m_arena.reset();
+    ActiveSet active(CloserToOrigin{&m_edges}, ArenaAllocator<unsigned int>(&m_arena));
+    m_activeAt.assign(m_edges.size(), active.end());
+    m_events.clear();
+    for (unsigned int i = 0; i < m_edges.size(); i++)
+    {
+        float begin = pseudoAngle(m_edges[i].begin);
+        float end = pseudoAngle(m_edges[i].end);
+        if (begin == end)
+            continue;
+        m_events.push_back({begin, i, true});
+        m_events.push_back({end, i, false});
+        // Edges across the +x axis are already under the ray the sweep starts with
+        if (begin > end)
+            m_activeAt[i] = active.insert(i);
+    }
+    // Ends first at equal angles, so an edge is gone before the one it joins comes in
+    std::sort(m_events.begin(), m_events.end(), [](const Event &a, const Event &b) {
+        if (a.angle != b.angle)
+            return a.angle < b.angle;
+        return !a.is_begin && b.is_begin;
+    });
+
+    auto emit = [&out_polygon](glm::vec2 p) {
+        if (out_polygon.empty() || glm::dot(p - out_polygon.back(), p - out_polygon.back()) > 1e-4f)
+            out_polygon.push_back(p);
+    };
+
+    // A vertex is only needed where the closest edge changes
+    size_t i = 0;
+    while (i < m_events.size())
+    {
+        const float angle = m_events[i].angle;
+        const Edge &first = m_edges[m_events[i].edge];
+        const glm::vec2 direction = m_events[i].is_begin ? first.begin : first.end;
+        const unsigned int before = active.empty() ? NO_EDGE : *active.begin();
+        for (; i < m_events.size() && m_events[i].angle == angle; i++)
+        {
+            const Event &event = m_events[i];
+            if (event.is_begin)
+                m_activeAt[event.edge] = active.insert(event.edge);
+            else if (m_activeAt[event.edge] != active.end())
+            {
+                active.erase(m_activeAt[event.edge]);
+                m_activeAt[event.edge] = active.end();
+            }
+        }
+        const unsigned int after = active.empty() ? NO_EDGE : *active.begin();
+        if (before == after)
+            continue;
+        if (before != NO_EDGE)
+            emit(hitAlong(direction, before));
+        if (after != NO_EDGE)
+            emit(hitAlong(direction, after));
+    }
+    if (out_polygon.size() > 1 && glm::dot(out_polygon.front() - out_polygon.back(), out_polygon.front() - out_polygon.back()) <= 1e-4f)
+        out_polygon.pop_back();
+
+    for (glm::vec2 &p : out_polygon)
+        p += origin;
+}
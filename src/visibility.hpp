@@ -0,0 +1,58 @@
+#pragma once
+
+#include <set>
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "scratch_arena.hpp"
+
+struct VisibilitySegment
+{
+    glm::vec2 a;
+    glm::vec2 b;
+};
+
+// Region seen from a point past a set of occluding segments, found with an angular sweep:
+// endpoints are sorted by angle once and the segments crossing the sweep ray are kept
+// ordered by distance, so the whole polygon costs O(n log n) for n segments.
+// Scratch storage is kept between calls and the active set's nodes come from an arena,
+// so once warmed up a call does not allocate.
+class VisibilitySweep
+{
+public:
+    // Writes the visible part of [bounds_min, bounds_max] around origin, ordered
+    // counterclockwise by angle. The polygon is star shaped from origin, so a triangle
+    // fan around origin covers it. Segments that cross each other are only resolved
+    // at endpoints, which is fine for walls and outlines that merely touch.
+    void compute(glm::vec2 origin, const std::vector<VisibilitySegment> &segments,
+                 glm::vec2 bounds_min, glm::vec2 bounds_max, std::vector<glm::vec2> &out_polygon);
+
+private:
+    // Endpoints relative to origin, begin comes first going counterclockwise
+    struct Edge
+    {
+        glm::vec2 begin;
+        glm::vec2 end;
+    };
+    struct Event
+    {
+        float angle; // pseudo angle in [0, 4), monotonic with the real one
+        unsigned int edge;
+        bool is_begin;
+    };
+    struct CloserToOrigin
+    {
+        const std::vector<Edge> *edges;
+        bool operator()(unsigned int lhs, unsigned int rhs) const;
+    };
+    using ActiveSet = std::multiset<unsigned int, CloserToOrigin, ArenaAllocator<unsigned int>>;
+
+    void addEdge(glm::vec2 a, glm::vec2 b);
+    glm::vec2 hitAlong(glm::vec2 direction, unsigned int edge) const;
+
+    std::vector<Edge> m_edges;
+    std::vector<Event> m_events;
+    std::vector<ActiveSet::iterator> m_activeAt;
+    ScratchArena m_arena{16 * 1024};
+};
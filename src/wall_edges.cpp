@@ -0,0 +1,110 @@
+#include "wall_edges.hpp"
+
+#include <algorithm>
+
+static bool isSolid(const std::vector<unsigned char> &solid, int width, int height, int x, int y)
+{
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return true;
+    return solid[y * width + x] != 0;
+}
+
+void extractWallEdges(const std::vector<unsigned char> &solid, int width, int height,
+                      glm::vec2 tile_size, std::vector<VisibilitySegment> &out)
+{
+    out.clear();
+
+    // 0 for no edge, otherwise which side of the grid line is open
+    enum { NONE = 0, OPEN_BEFORE = 1, OPEN_AFTER = 2 };
+
+    // Horizontal grid lines, between row y - 1 above and row y below
+    for (int y = 0; y <= height; y++)
+    {
+        int run = NONE;
+        int run_start = 0;
+        for (int x = 0; x <= width; x++)
+        {
+            int kind = NONE;
+            if (x < width)
+            {
+                bool above = isSolid(solid, width, height, x, y - 1);
+                bool below = isSolid(solid, width, height, x, y);
+                if (above != below)
+                    kind = above ? OPEN_AFTER : OPEN_BEFORE;
+            }
+            if (kind == run)
+                continue;
+            if (run != NONE)
+            {
+                glm::vec2 a(run_start * tile_size.x, y * tile_size.y);
+                glm::vec2 b(x * tile_size.x, y * tile_size.y);
+                out.push_back(run == OPEN_AFTER ? VisibilitySegment{a, b} : VisibilitySegment{b, a});
+            }
+            run = kind;
+            run_start = x;
+        }
+    }
+
+    // Vertical grid lines, between column x - 1 on the left and column x on the right
+    for (int x = 0; x <= width; x++)
+    {
+        int run = NONE;
+        int run_start = 0;
+        for (int y = 0; y <= height; y++)
+        {
+            int kind = NONE;
+            if (y < height)
+            {
+                bool left = isSolid(solid, width, height, x - 1, y);
+                bool right = isSolid(solid, width, height, x, y);
+                if (left != right)
+                    kind = left ? OPEN_AFTER : OPEN_BEFORE;
+            }
+            if (kind == run)
+                continue;
+            if (run != NONE)
+            {
+                glm::vec2 a(x * tile_size.x, run_start * tile_size.y);
+                glm::vec2 b(x * tile_size.x, y * tile_size.y);
+                out.push_back(run == OPEN_AFTER ? VisibilitySegment{b, a} : VisibilitySegment{a, b});
+            }
+            run = kind;
+            run_start = y;
+        }
+    }
+}
+
+static float cross(glm::vec2 a, glm::vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+bool segmentBlocked(glm::vec2 from, glm::vec2 to, const std::vector<VisibilitySegment> &edges)
+{
+    const glm::vec2 d = to - from;
+    const glm::vec2 lo = glm::vec2(std::min(from.x, to.x), std::min(from.y, to.y));
+    const glm::vec2 hi = glm::vec2(std::max(from.x, to.x), std::max(from.y, to.y));
+    for (const VisibilitySegment &edge : edges)
+    {
+        // Wall edges are axis aligned and mostly far away, the box test rejects nearly all
+        if (std::max(edge.a.x, edge.b.x) < lo.x || std::min(edge.a.x, edge.b.x) > hi.x ||
+            std::max(edge.a.y, edge.b.y) < lo.y || std::min(edge.a.y, edge.b.y) > hi.y)
+            continue;
+
+        const glm::vec2 e = edge.b - edge.a;
+        const float denom = cross(d, e);
+        const glm::vec2 w = edge.a - from;
+        if (denom == 0.f)
+        {
+            // Parallel, only blocks when running along the edge
+            if (cross(w, d) == 0.f)
+                return true;
+            continue;
+        }
+        const float t = cross(w, e) / denom;
+        const float u = cross(w, d) / denom;
+        if (t >= 0.f && t <= 1.f && u >= 0.f && u <= 1.f)
+            return true;
+    }
+    return false;
+}
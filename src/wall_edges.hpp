@@ -0,0 +1,20 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/vec2.hpp>
+
+#include "visibility.hpp"
+
+// Silhouette of the solid cells of a tile grid, the contour marching squares finds on a
+// binary grid whose walls are whole tiles. Only edges between a solid and an open cell
+// are kept and runs along the same grid line are merged into one segment, so a straight
+// wall of any length is a single edge. Cells outside the grid count as solid, the room
+// border is left to whoever bounds the space. Segments are wound so that
+// cross(b - a, p - a) > 0 for points p on the open side.
+// solid is row major, width * height cells, tile (0, 0) starts at the origin.
+void extractWallEdges(const std::vector<unsigned char> &solid, int width, int height,
+                      glm::vec2 tile_size, std::vector<VisibilitySegment> &out);
+
+// Whether the segment from -> to crosses any of the edges. Touching counts as crossing.
+bool segmentBlocked(glm::vec2 from, glm::vec2 to, const std::vector<VisibilitySegment> &edges);
@@ -7,6 +7,9 @@
 #include "world_system.hpp"
 #include "wfc/tiling_wfc.hpp"
 #include "wfc/array2D.hpp"
+#include "wall_edges.hpp"
+#include "seed_race.hpp"
+#include "thread_pool.hpp"
 
 #include <cstdio>
 #include <iostream>
@@ -271,11 +274,7 @@ void writePart(RenderSystem *renderer, std::ofstream &f, ComponentContainer<Moti
         }
         if (registry.necromancers.has(e))
         {
-            Necromancer &necro = registry.necromancers.get(e);
             f << "necromancer" << "\n";
-            f << necro.spawningMinions << "\n";
-            f << necro.centerPosition.x << "\n";
-            f << necro.centerPosition.y << "\n";
         }
         if (registry.pathfinders.has(e))
         {
@@ -298,10 +297,6 @@ void SaveGameToFile(RenderSystem *renderer)
 {
     std::ofstream f("../Save1.data");
 
-    // Remove all health bars so they do not re-appear when reloaded
-    while (registry.healthBars.entities.size() > 0)
-        registry.remove_all_components_of(registry.healthBars.entities.back());
-
     writePart(renderer, f, &registry.motions);
     writePart(renderer, f, &registry.wallMotions);
     writePart(renderer, f, &registry.projectileMotions);
@@ -350,6 +345,16 @@ void SaveGameToFile(RenderSystem *renderer)
     f.close();
 }
 
+// Lights are not saved, the entities that carry one get it back on load
+static void addFollowLight(RenderSystem *renderer, Entity entity, float radius)
+{
+    if (!renderer->lightSystemEnabled())
+        return;
+    Light &light = registry.lights.emplace(entity);
+    light.radius = radius;
+    light.follow = true;
+}
+
 int LoadInt(std::ifstream &f)
 {
     std::string line;
@@ -552,6 +557,7 @@ bool LoadGameFromFile(RenderSystem *renderer)
             Projectile &p = registry.projectiles.emplace(e);
             p.bounces_remaining = LoadInt(f);
             p.is_player_projectile = LoadInt(f);
+            addFollowLight(renderer, e, PROJECTILE_LIGHT_RADIUS);
         }
         else if (line == "reload_time")
         {
@@ -595,6 +601,7 @@ bool LoadGameFromFile(RenderSystem *renderer)
         else if (line == "boss")
         {
             Boss &b = registry.bosses.emplace(e);
+            addFollowLight(renderer, e, BOSS_LIGHT_RADIUS);
         }
         else if (line == "teleporter")
         {
@@ -625,10 +632,9 @@ bool LoadGameFromFile(RenderSystem *renderer)
         }
         else if (line == "necromancer")
         {
-            Necromancer &n = registry.necromancers.emplace(e);
-            n.spawningMinions = LoadBool(f);
-            n.centerPosition.x = LoadFloat(f);
-            n.centerPosition.y = LoadFloat(f);
+            // Older saves follow this with three values the component no longer has,
+            // lines that are not a tag are skipped
+            registry.necromancers.emplace(e);
         }
         else if (line == "pathfinder")
         {
@@ -674,6 +680,7 @@ bool LoadGameFromFile(RenderSystem *renderer)
                 }
             }
             gm.gridMap = gridMap;
+            buildWallEdges(gm);
             printf("%d size \n", registry.gridMaps.size());
         }
         else if (line == "light_up")
@@ -683,9 +690,31 @@ bool LoadGameFromFile(RenderSystem *renderer)
         }
     }
 
+    renderer->bakeWallChunks();
+
     return true;
 }
 
+// The border of the room is always wall, even where the wfc tile is open
+void buildWallEdges(GridMap &grid)
+{
+    std::vector<unsigned char> solid(grid.matrixWidth * grid.matrixHeight);
+    for (int y = 0; y < grid.matrixHeight; y++)
+    {
+        for (int x = 0; x < grid.matrixWidth; x++)
+        {
+            bool border = x == 0 || y == 0 || x == grid.matrixWidth - 1 || y == grid.matrixHeight - 1;
+            solid[y * grid.matrixWidth + x] = border || grid.gridMap[y][x].notWalkable;
+        }
+    }
+    vec2 tileSize = grid.matrixWidth > 0 && grid.matrixHeight > 0 ? grid.gridMap[0][0].size : vec2(50, 50);
+    extractWallEdges(solid, grid.matrixWidth, grid.matrixHeight, tileSize, grid.wall_edges);
+
+    // Unique across rooms, so whatever was built from older edges sees the change
+    static unsigned int wall_version = 0;
+    grid.wall_version = ++wall_version;
+}
+
 void NextRoom(RenderSystem *renderer, int seed)
 {
     for (int i = (int)registry.motions.size() - 1; i >= 0; i--)
@@ -705,6 +734,27 @@ void NextRoom(RenderSystem *renderer, int seed)
     GenerateMap(renderer, seed);
 }
 
+// A generated map and the walls next to its open cells
+struct MapAttempt
+{
+    Array2D<int> map = Array2D<int>(1, 1);
+    std::unordered_set<std::pair<int, int>, pair_hash> exposed_walls;
+};
+
+static MapGenerationStats mapGenerationStats;
+
+// Threads that race map seeds, started with the first room
+static ThreadPool &mapGenerationPool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+MapGenerationStats getMapGenerationStats()
+{
+    return mapGenerationStats;
+}
+
 void GenerateMap(RenderSystem *renderer, int seed)
 {
 
@@ -827,20 +877,19 @@ void GenerateMap(RenderSystem *renderer, int seed)
     int tileLength = 5;
     bool periodic_output = true;
 
-    std::unordered_set<std::pair<int, int>, pair_hash> exposed_walls;
-    Array2D<int> result(1, 1);
-    bool success = false;
-    while (!success)
-    {
-        success = false;
+    // One seed, kept only if every open cell can be reached from the start.
+    // Runs on the generation threads, tiles and neighbors_ids are only read.
+    auto attempt = [&](int attempt_seed, MapAttempt &out) {
+        out.exposed_walls.clear();
         try
         {
-            TilingWFC<int> wfc = TilingWFC<int>(tiles, neighbors_ids, height, width, {periodic_output}, seed);
+            TilingWFC<int> wfc = TilingWFC<int>(tiles, neighbors_ids, height, width, {periodic_output}, attempt_seed);
 
             wfc.set_tile(EMPTY, 0, height / 2, 0);
             wfc.set_tile(EMPTY, 0, height / 2, width - 1);
 
-            result = wfc.run();
+            out.map = wfc.run();
+            const Array2D<int> &result = out.map;
 
             // check if a valid path from start to end exists (can the level be completed?)
             std::pair<int, int> start = {result.height / 2, 0};
@@ -866,7 +915,7 @@ void GenerateMap(RenderSystem *renderer, int seed)
                     }
                     else
                     {
-                        exposed_walls.insert({y, x - 1});
+                        out.exposed_walls.insert({y, x - 1});
                     }
                 }
 
@@ -878,7 +927,7 @@ void GenerateMap(RenderSystem *renderer, int seed)
                     }
                     else
                     {
-                        exposed_walls.insert({y, x + 1});
+                        out.exposed_walls.insert({y, x + 1});
                     }
                 }
 
@@ -890,7 +939,7 @@ void GenerateMap(RenderSystem *renderer, int seed)
                     }
                     else
                     {
-                        exposed_walls.insert({y - 1, x});
+                        out.exposed_walls.insert({y - 1, x});
                     }
                 }
 
@@ -902,7 +951,7 @@ void GenerateMap(RenderSystem *renderer, int seed)
                     }
                     else
                     {
-                        exposed_walls.insert({y + 1, x});
+                        out.exposed_walls.insert({y + 1, x});
                     }
                 }
             }
@@ -918,13 +967,23 @@ void GenerateMap(RenderSystem *renderer, int seed)
 
             // std::cout << "COUNT: " << visited.size() << " " << path_count << std::endl;
 
-            success = (path_count == visited.size());
+            return path_count == visited.size();
         }
         catch (...)
         {
+            // contradiction, try another seed
         }
-        seed++;
-    }
+        return false;
+    };
+
+    MapAttempt generated;
+    SeedRaceStats race = raceSeeds(mapGenerationPool(), seed, attempt, generated);
+    mapGenerationStats.rooms++;
+    mapGenerationStats.attempts += race.attempts;
+    mapGenerationStats.serial_attempts += race.serial_attempts;
+
+    const Array2D<int> &result = generated.map;
+    const std::unordered_set<std::pair<int, int>, pair_hash> &exposed_walls = generated.exposed_walls;
 
     vec2 tileSize = vec2(50, 50);
 
@@ -961,6 +1020,8 @@ void GenerateMap(RenderSystem *renderer, int seed)
         }
     }
 
+    buildWallEdges(gridMapComp);
+
     for (Entity e : gridMapComp.exposed_walls) {
         Motion& wallMotion = registry.wallMotions.get(e);
         Motion& exposedWallMotion = registry.exposedWallMotions.emplace(e);
@@ -973,6 +1034,8 @@ void GenerateMap(RenderSystem *renderer, int seed)
         exposedWallMotion.last_move_direction = wallMotion.last_move_direction;
     }
 
+    // The walls are final now, bake them for the renderer
+    renderer->bakeWallChunks();
 
 
     // std::cout << "EXPOSED WALLS:" << gridMapComp.exposed_walls.size() << std::endl;
@@ -1163,6 +1226,7 @@ Entity createCowboyBossEnemy(RenderSystem *renderer, vec2 position)
     registry.teleporters.emplace(entity);
 
     registry.bosses.emplace(entity);
+    addFollowLight(renderer, entity, BOSS_LIGHT_RADIUS);
 
     Animation &animation = registry.animations.emplace(entity);
     animation.sprite_height = 32;
@@ -1315,6 +1379,7 @@ Entity createNecromancerEnemy(RenderSystem *renderer, vec2 position)
 
     registry.bosses.emplace(entity);
     registry.necromancers.emplace(entity);
+    addFollowLight(renderer, entity, BOSS_LIGHT_RADIUS);
 
     registry.pathfinders.emplace(entity);
 
@@ -1365,12 +1430,59 @@ Entity createWall(RenderSystem *renderer, vec2 position, vec2 size, float angle)
     return entity;
 }
 
+// Entities of released projectiles, ready to be handed out again
+static std::vector<Entity> projectile_free_list;
+
+void initProjectilePool()
+{
+    projectile_free_list.clear();
+    projectile_free_list.reserve(PROJECTILE_POOL_CAPACITY);
+    registry.projectiles.reserve(PROJECTILE_POOL_CAPACITY);
+    registry.projectileMotions.reserve(PROJECTILE_POOL_CAPACITY);
+}
+
+// Only the five containers createProjectile fills are touched, each an O(1) swap-remove
+void releaseProjectile(Entity entity)
+{
+    bool was_active = registry.projectiles.has(entity);
+
+    registry.lights.remove(entity);
+    registry.projectileMotions.remove(entity);
+    registry.projectiles.remove(entity);
+    registry.renderRequests.remove(entity);
+    registry.meshPtrs.remove(entity);
+
+    if (was_active && projectile_free_list.size() < PROJECTILE_POOL_CAPACITY)
+        projectile_free_list.push_back(entity);
+}
+
+void createMuzzleFlash(RenderSystem *renderer, vec2 position)
+{
+    if (!renderer->lightSystemEnabled())
+        return;
+    auto entity = Entity();
+    Light &light = registry.lights.emplace(entity);
+    light.position = position;
+    light.radius = MUZZLE_FLASH_RADIUS;
+    light.timer = MUZZLE_FLASH_TIME;
+}
+
 // create a projectile
 Entity createProjectile(RenderSystem *renderer, vec2 pos, float angle, bool is_player_projectile, float speed)
 {
     const float scaleMultiplier = 0.5;
 
-    auto entity = Entity();
+    // Re-use a released projectile entity if there is one
+    Entity entity = 0;
+    if (projectile_free_list.empty())
+    {
+        entity = Entity();
+    }
+    else
+    {
+        entity = projectile_free_list.back();
+        projectile_free_list.pop_back();
+    }
 
     // Store a reference to the potentially re-used mesh object
     Mesh &mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::PROJECTILE);
@@ -1390,6 +1502,8 @@ Entity createProjectile(RenderSystem *renderer, vec2 pos, float angle, bool is_p
     Projectile &projectile = registry.projectiles.emplace(entity);
     projectile.is_player_projectile = is_player_projectile;
 
+    addFollowLight(renderer, entity, PROJECTILE_LIGHT_RADIUS);
+
     /* Animation &animation = registry.animations.emplace(entity); */
     /* animation.sprite_height = 32; */
     /* animation.sprite_width = 13; */
@@ -1489,28 +1603,6 @@ Entity createHealthStealerPowerUp(RenderSystem *renderer, vec2 position)
     return entity;
 }
 
-Entity createHealthBar(RenderSystem *renderer, vec2 position, vec2 scale, bool isPlayer)
-{
-    Entity entity = Entity();
-
-    Mesh &mesh = renderer->getMesh(GEOMETRY_BUFFER_ID::SPRITE);
-    registry.meshPtrs.emplace(entity, &mesh);
-    
-    TEXTURE_ASSET_ID healthbarType = isPlayer ? TEXTURE_ASSET_ID::PLAYER_HEALTH_BAR : TEXTURE_ASSET_ID::HEALTH_BAR;
-    registry.renderRequests.insert(
-        entity, {healthbarType,
-                 EFFECT_ASSET_ID::TEXTURED,
-                 GEOMETRY_BUFFER_ID::SPRITE});
-
-    Motion &motion = registry.motions.emplace(entity);
-    motion.entity = entity;
-    motion.position = position;
-    motion.scale = scale;
-
-    registry.healthBars.emplace(entity);
-    return entity;
-}
-
 Entity createText(RenderSystem *renderer, std::string text, vec2 position, float scale, vec3 color)
 {
     Entity entity = Entity();
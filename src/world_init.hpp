@@ -17,6 +17,14 @@ const float ENEMY_BB_WIDTH = 0.6f * 165.f;  // 870
 const float PROJECTILE_BB_HEIGHT = 0.6f * 150.f;
 const float PROJECTILE_BB_WIDTH = 0.6f * 75.f;
 
+const size_t PROJECTILE_POOL_CAPACITY = 256;
+
+// How far the dynamic lights reach, and how long a muzzle flash lasts in seconds
+const float PROJECTILE_LIGHT_RADIUS = 120.f;
+const float BOSS_LIGHT_RADIUS = 260.f;
+const float MUZZLE_FLASH_RADIUS = 200.f;
+const float MUZZLE_FLASH_TIME = 0.08f;
+
 const float POWERUP_BB_HEIGHT = 100;
 const float POWERUP_BB_WIDTH = 100;
 
@@ -69,9 +77,22 @@ bool LoadGameFromFile(RenderSystem *renderer);
 bool doesSaveFileExist(RenderSystem *renderer);
 
 void NextRoom(RenderSystem *renderer, int seed);
+// Races consecutive seeds from seed on worker threads, the lowest one that makes a
+// completable room wins so a seed always gives the same room
 void GenerateMap(RenderSystem *renderer, int seed);
+
+// Totals over every room generated so far
+struct MapGenerationStats
+{
+    unsigned int rooms = 0;
+    unsigned int attempts = 0;        // seeds tried on all threads
+    unsigned int serial_attempts = 0; // seeds a one at a time search would have tried
+};
+MapGenerationStats getMapGenerationStats();
 Entity createTile(RenderSystem *renderer, vec2 pos, vec2 size, TT type);
 void createGridNode(std::vector<std::vector<GridNode>> &gridMap, vec2 pos, vec2 size, int value);
+// Extracts the merged wall outline of the grid into grid.wall_edges
+void buildWallEdges(GridMap &grid);
 // the player
 Entity createPlayer(RenderSystem *renderer, vec2 pos);
 
@@ -84,10 +105,16 @@ Entity createCowboyBossEnemy(RenderSystem *renderer, vec2 position);
 // the game walls
 Entity createWall(RenderSystem *renderer, vec2 position, vec2 size, float angle = 0);
 
-Entity createHealthBar(RenderSystem *renderer, vec2 position, vec2 size, bool isPlayer);
-
 Entity createProjectile(RenderSystem *renderer, vec2 pos, float angle, bool is_player_projectile, float speed = 500);
 
+// Projectiles are recycled: release returns the entity to the pool instead of
+// walking every registry container with remove_all_components_of
+void initProjectilePool();
+void releaseProjectile(Entity entity);
+
+// Short lived light where a shot was fired, none while the light system is off
+void createMuzzleFlash(RenderSystem *renderer, vec2 position);
+
 Entity createInvincibilityPowerUp(RenderSystem *renderer, vec2 position);
 
 Entity createSuperBulletsPowerUp(RenderSystem *renderer, vec2 position);
@@ -9,6 +9,7 @@
 #include <GLFW/glfw3.h>
 #include <cassert>
 #include <csignal>
+#include <iomanip>
 #include <sstream>
 #include <string>
 
@@ -195,6 +196,7 @@ void WorldSystem::init(RenderSystem *renderer_arg)
 {
     this->renderer = renderer_arg;
     initLevels();
+    initProjectilePool();
     // Playing background music indefinitely
     Mix_PlayMusic(background_music, -1);
     fprintf(stderr, "Loaded music\n");
@@ -276,14 +278,18 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     // Show Current Level
     int w, h;
     glfwGetWindowSize(renderer->getWindow(), &w, &h);
+    // HUD strings are only rebuilt when the number they show changes
     if (!registry.texts.has(showLevel))
     {
         showLevel = createText(renderer, "Level " + std::to_string(currLevels.current_level + 1), vec2(w / 2 + w * 0.36f, h * 0.07f), 2.0f, {1.0, 0.0, 0.0}, false);
+        shownLevel = currLevels.current_level;
     }
-    else
+    else if (shownLevel != currLevels.current_level)
     {
         Text &showLevelText = registry.texts.get(showLevel);
         showLevelText.text = "Level " + std::to_string(currLevels.current_level + 1);
+        showLevelText.dirty = true;
+        shownLevel = currLevels.current_level;
     }
 
     // Get current level 
@@ -291,13 +297,15 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     int numActiveEnemies = registry.enemies.size();
     int numUnspawnedEnemies = currLevelStruct->num_melee + currLevelStruct->num_ranged + currLevelStruct->num_boss;
     int numEnemiesLeft = numActiveEnemies + numUnspawnedEnemies;
-    std::string numEnemyText = "Enemies remaining: " + std::to_string(numEnemiesLeft);
     if (!registry.texts.has(showProgress)) {
-        showProgress = createText(renderer, numEnemyText, vec2(w*0.015f, h*0.07f), 2.0f, {1.0, 0.0, 0.0}, false);
+        showProgress = createText(renderer, "Enemies remaining: " + std::to_string(numEnemiesLeft), vec2(w*0.015f, h*0.07f), 2.0f, {1.0, 0.0, 0.0}, false);
+        shownEnemiesLeft = numEnemiesLeft;
     }
-    else {
+    else if (shownEnemiesLeft != numEnemiesLeft) {
         Text &levelProgressText = registry.texts.get(showProgress);
-        levelProgressText.text = numEnemyText; 
+        levelProgressText.text = "Enemies remaining: " + std::to_string(numEnemiesLeft);
+        levelProgressText.dirty = true;
+        shownEnemiesLeft = numEnemiesLeft;
     }
 
 
@@ -319,6 +327,20 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
 
         std::stringstream title_ss;
         title_ss << "Ricochet Rage | FPS: " << FPS;
+
+        const RenderSystem::RenderStats &stats = renderer->getRenderStats();
+        title_ss << " | Sprites drawn: " << stats.sprites_drawn << " culled: " << stats.sprites_culled;
+        title_ss << " | Wall chunks drawn: " << stats.chunks_drawn << " culled: " << stats.chunks_culled;
+        title_ss << " | Draws: " << stats.draw_calls << " Binds: " << stats.gl_binds << " skipped: " << stats.gl_binds_skipped;
+        title_ss << " | Streamed: " << stats.stream_bytes / 1024 << " KB (orphans: " << stats.stream_orphans << ")";
+        title_ss << " | Lights drawn: " << stats.lights_drawn << " culled: " << stats.lights_culled << " recomputed: " << stats.lights_computed << " occluders moved: " << stats.light_occluders_moved;
+        title_ss << " | Render scale: " << (int)(stats.render_scale * 100.f + 0.5f) << "% GPU: " << std::fixed << std::setprecision(1) << stats.gpu_frame_ms << " ms";
+        const MapGenerationStats map_stats = getMapGenerationStats();
+        if (map_stats.rooms > 0)
+        {
+            title_ss << " | Map seeds per room: " << (float)map_stats.attempts / map_stats.rooms
+                     << " (in order: " << (float)map_stats.serial_attempts / map_stats.rooms << ")";
+        }
         glfwSetWindowTitle(window, title_ss.str().c_str());
     }
 
@@ -326,10 +348,6 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     while (registry.debugComponents.entities.size() > 0)
         registry.remove_all_components_of(registry.debugComponents.entities.back());
 
-    // Remove all health bars from last step
-    while (registry.healthBars.entities.size() > 0)
-        registry.remove_all_components_of(registry.healthBars.entities.back());
-
     for (Entity entity : registry.texts.entities)
     {
         Text &text = registry.texts.get(entity);
@@ -338,7 +356,20 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
             text.timer -= elapsed_ms_since_last_update / 1000.f;
             if (text.timer < 0)
             {
-                registry.remove_all_components_of(entity);
+                registry.defer_remove_all_components_of(entity);
+            }
+        }
+    }
+
+    for (Entity entity : registry.lights.entities)
+    {
+        Light &light = registry.lights.get(entity);
+        if (light.timer >= 0.f)
+        {
+            light.timer -= elapsed_ms_since_last_update / 1000.f;
+            if (light.timer < 0)
+            {
+                registry.defer_remove_all_components_of(entity);
             }
         }
     }
@@ -353,7 +384,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
             powerUp.active_timer -= elapsed_ms_since_last_update / 1000.f;
             if (powerUp.active_timer < 0)
             {
-                registry.remove_all_components_of(entity);
+                registry.defer_remove_all_components_of(entity);
             }
             else
             {
@@ -377,7 +408,7 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
             powerUp.available_timer -= elapsed_ms_since_last_update / 1000.f;
             if (powerUp.available_timer < 0)
             {
-                registry.remove_all_components_of(entity);
+                registry.defer_remove_all_components_of(entity);
             }
         }
     }
@@ -404,56 +435,14 @@ bool WorldSystem::step(float elapsed_ms_since_last_update)
     }
 
     // Check if the health of enemies or player is 0
-    for (Entity &entity : registry.healths.entities)
+    // Iterate backwards, health_check removes dead enemies from the container
+    for (int i = (int)registry.healths.size() - 1; i >= 0; i--)
     {
-        Health &health = registry.healths.get(entity);
+        Entity entity = registry.healths.entities[i];
+        Health &health = registry.healths.components[i];
         health_check(health, entity);
     }
 
-    // Create player healthbar
-    Motion &playerMotion = registry.motions.get(player);
-    Health &health = registry.healths.get(player);
-
-    float healthNormalized = health.value / 100.f;
-
-    createHealthBar(
-        renderer,
-        {playerMotion.position.x, playerMotion.position.y - abs(playerMotion.scale.y) / 2 - 15.f},
-        {abs(playerMotion.scale.x) * healthNormalized, 8.f}, true);
-
-    // Create enemy healthbars
-    for (Motion &m : registry.enemyMotions.components)
-    {
-        if (registry.healths.has(m.entity))
-        {
-            Health &health = registry.healths.get(m.entity);
-
-            float healthNormalized;
-            if (registry.bosses.has(m.entity))
-            {
-                healthNormalized = health.value / 300.f;
-            }
-            else
-            {
-                healthNormalized = health.value / 100.f;
-            }
-            if (m.entity == player) {
-            createHealthBar(
-                renderer,
-                {m.position.x, m.position.y - abs(m.scale.y) / 2 - 15.f},
-                {abs(m.scale.x) * healthNormalized, 8.f}, true);
-
-            }
-            else {
-                createHealthBar(
-                    renderer,
-                    {m.position.x, m.position.y - abs(m.scale.y) / 2 - 15.f},
-                    {abs(m.scale.x) * healthNormalized, 8.f}, false);
-
-            }
-        }
-    }
-
     auto &damageEffects = registry.damageEffect;
     // Check for damage effect
     if (damageEffects.has(player))
@@ -686,16 +675,15 @@ void WorldSystem::restart_game()
     }
     for (Entity &e : registry.enemyMotions.entities)
     {
-        registry.remove_all_components_of(e);
-    }
-    for (Entity &e : registry.projectileMotions.entities)
-    {
-        registry.remove_all_components_of(e);
+        registry.defer_remove_all_components_of(e);
     }
+    while (registry.projectileMotions.entities.size() > 0)
+        releaseProjectile(registry.projectileMotions.entities.back());
     for (Entity &e : registry.wallMotions.entities)
     {
-        registry.remove_all_components_of(e);
+        registry.defer_remove_all_components_of(e);
     }
+    registry.flush_deferred();
 
     // Debugging for memory/component leaks
     registry.list_all_components();
@@ -780,8 +768,8 @@ void WorldSystem::projectile_hit_character(Entity laser, Entity character)
         }
     }
 
-    // Remove the projectile
-    registry.remove_all_components_of(laser);
+    // Return the projectile to the pool
+    releaseProjectile(laser);
 }
 
 void WorldSystem::health_check(Health &health, const Entity &character)
@@ -1026,7 +1014,7 @@ void WorldSystem::handle_collisions(float elapsed_ms)
         Projectile &projectile = registry.projectiles.get(entity);
         if (projectile.bounces_remaining-- == 0)
         {
-            registry.remove_all_components_of(entity);
+            releaseProjectile(entity);
             continue;
         }
         else
@@ -1173,6 +1161,19 @@ void WorldSystem::on_key(int key, int, int action, int mod)
         renderer->flipActiveButtions(renderer->getActiveScreen());
     }
 
+    // Scene resolution: full, half, then dynamic to hold the frame time
+    if (action == GLFW_RELEASE && key == GLFW_KEY_F11)
+    {
+        int mode = ((int)renderer->getRenderScaleMode() + 1) % (int)RENDER_SCALE_MODE::MODE_COUNT;
+        renderer->setRenderScaleMode((RENDER_SCALE_MODE)mode);
+    }
+
+    // Record the light inputs and what they cover, replayable by the shadow mask test
+    if (action == GLFW_RELEASE && key == GLFW_KEY_F12)
+    {
+        renderer->saveLightScene(data_path() + "/light_scene");
+    }
+
     // Resetting game
     if (action == GLFW_RELEASE && key == GLFW_KEY_R)
     {
@@ -1376,6 +1377,7 @@ void WorldSystem::on_mouse_click(int button, int action, int mods)
             {
                 Mix_PlayChannel(-1, laser_shot_sound, 0);
                 createProjectile(renderer, motion.position, motion.angle, true);
+                createMuzzleFlash(renderer, motion.position);
             }
         }
     }
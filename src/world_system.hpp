@@ -102,8 +102,10 @@ private:
 
     // Show Level
     Entity showLevel;
+    int shownLevel = -1;
 
     Entity showProgress;
+    int shownEnemiesLeft = -1;
     int startingNumEnemies;
 
 
@@ -0,0 +1,83 @@
+#include "animation.hpp"
+#include "check.hpp"
+
+static Animation makeAnimation(int num_frames, bool loop)
+{
+    Animation anim;
+    anim.frame_time = 0.2f;
+    anim.num_frames = num_frames;
+    anim.sprite_width = 32;
+    anim.sprite_height = 32;
+    anim.loop = loop;
+    return anim;
+}
+
+static void testStepsOnFrameTime()
+{
+    Animation anim = makeAnimation(4, true);
+    advanceAnimation(anim, true, 0.15f);
+    CHECK(anim.current_frame == 0);
+    CHECK(anim.current_time == 0.15f);
+    advanceAnimation(anim, true, 0.1f);
+    CHECK(anim.current_frame == 1);
+    CHECK(anim.current_time == 0.f);
+    // A long frame still only moves one frame on
+    advanceAnimation(anim, true, 1.f);
+    CHECK(anim.current_frame == 2);
+}
+
+static void testLoops()
+{
+    Animation anim = makeAnimation(3, true);
+    for (int i = 0; i < 3; i++)
+        advanceAnimation(anim, true, 0.2f);
+    CHECK(anim.current_frame == 0);
+    CHECK(anim.is_playing);
+}
+
+static void testStopsOnLastFrame()
+{
+    Animation anim = makeAnimation(3, false);
+    for (int i = 0; i < 3; i++)
+        advanceAnimation(anim, true, 0.2f);
+    CHECK(anim.current_frame == 2);
+    CHECK(!anim.is_playing);
+    // Stopped animations are left alone, running or not
+    advanceAnimation(anim, true, 0.2f);
+    advanceAnimation(anim, false, 0.2f);
+    CHECK(anim.current_frame == 2);
+    CHECK(!anim.is_playing);
+}
+
+static void testIdleHoldsFirstFrame()
+{
+    Animation anim = makeAnimation(4, true);
+    advanceAnimation(anim, true, 0.2f);
+    advanceAnimation(anim, true, 0.1f);
+    CHECK(anim.current_frame == 1);
+    advanceAnimation(anim, false, 0.1f);
+    CHECK(anim.current_frame == 0);
+    CHECK(anim.current_time == 0.f);
+    CHECK(anim.is_playing);
+}
+
+static void testPausedIsUntouched()
+{
+    Animation anim = makeAnimation(4, true);
+    anim.current_frame = 2;
+    anim.current_time = 0.1f;
+    anim.is_playing = false;
+    advanceAnimation(anim, true, 0.5f);
+    CHECK(anim.current_frame == 2);
+    CHECK(anim.current_time == 0.1f);
+}
+
+int main()
+{
+    testStepsOnFrameTime();
+    testLoops();
+    testStopsOnLastFrame();
+    testIdleHoldsFirstFrame();
+    testPausedIsUntouched();
+    return testResult();
+}
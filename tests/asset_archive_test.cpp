@@ -0,0 +1,267 @@
+#include "asset_archive.hpp"
+#include "check.hpp"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <sys/utime.h>
+#define utime _utime
+#define utimbuf _utimbuf
+#else
+#include <utime.h>
+#endif
+
+// Stands in for TexturedVertex, the archive only cares about its size
+struct TestVertex
+{
+    float position[3];
+    float texcoord[2];
+};
+
+static std::string scratch_dir;
+
+static std::string scratchPath(const std::string &name)
+{
+    return scratch_dir + "/" + name;
+}
+
+static bool writeFile(const std::string &path, const std::string &bytes)
+{
+    std::ofstream os(path, std::ios::binary);
+    os << bytes;
+    return os.good();
+}
+
+static std::string readFile(const std::string &path)
+{
+    std::ifstream is(path, std::ios::binary);
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    return ss.str();
+}
+
+// A mesh blob: header, vertices, then the vertex and uv indices
+static std::vector<unsigned char> meshBlob(uint32_t vertex_count, uint32_t vertex_index_count, uint32_t uv_index_count,
+                                           uint32_t stored_vertices)
+{
+    AssetMeshHeader header = {vertex_count, vertex_index_count, uv_index_count, {1.f, 2.f}};
+    std::vector<unsigned char> blob(sizeof(header) + stored_vertices * sizeof(TestVertex) +
+                                    (vertex_index_count + uv_index_count) * sizeof(uint16_t));
+    memcpy(blob.data(), &header, sizeof(header));
+    for (size_t i = sizeof(header); i < blob.size(); i++)
+        blob[i] = (unsigned char)i;
+    return blob;
+}
+
+static const char RAW_BYTES[] = "font bytes";
+static const char SHADER_SOURCE[] = "#version 330 core\nvoid main() {}\n";
+static const unsigned char PIXELS[2 * 3 * 4] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+                                                13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24};
+
+// One entry of every type, the sources are files in the scratch dir
+static AssetArchiveWriter validArchive()
+{
+    writeFile(scratchPath("font.ttf"), RAW_BYTES);
+    writeFile(scratchPath("shader.glsl"), SHADER_SOURCE);
+    writeFile(scratchPath("image.png"), "png");
+    writeFile(scratchPath("mesh.obj"), "obj");
+    std::vector<unsigned char> mesh = meshBlob(3, 3, 3, 3);
+
+    AssetArchiveWriter writer;
+    writer.add("font.ttf", scratchPath("font.ttf"), ASSET_TYPE::RAW, RAW_BYTES, sizeof(RAW_BYTES));
+    writer.add("shader.glsl", scratchPath("shader.glsl"), ASSET_TYPE::SHADER, SHADER_SOURCE, strlen(SHADER_SOURCE));
+    writer.add("image.png", scratchPath("image.png"), ASSET_TYPE::IMAGE_RGBA, PIXELS, sizeof(PIXELS), 2, 3);
+    writer.add("mesh.obj", scratchPath("mesh.obj"), ASSET_TYPE::MESH, mesh.data(), mesh.size());
+    return writer;
+}
+
+static bool sameBytes(const AssetArchive &archive, const AssetTocEntry *entry, const void *bytes, size_t size)
+{
+    return entry != nullptr && entry->size == size && memcmp(archive.data(*entry), bytes, size) == 0;
+}
+
+static void testRoundtrip()
+{
+    const std::string path = scratchPath("valid.pak");
+    CHECK(validArchive().write(path));
+
+    AssetArchive archive;
+    CHECK(archive.open(path));
+    CHECK(archive.isOpen());
+    CHECK(archive.entryCount() == 4);
+    CHECK(sameBytes(archive, archive.find("font.ttf"), RAW_BYTES, sizeof(RAW_BYTES)));
+    CHECK(sameBytes(archive, archive.find("shader.glsl"), SHADER_SOURCE, strlen(SHADER_SOURCE)));
+    const AssetTocEntry *image = archive.find("image.png");
+    CHECK(sameBytes(archive, image, PIXELS, sizeof(PIXELS)));
+    CHECK(image != nullptr && image->width == 2 && image->height == 3);
+    CHECK(archive.find("missing.png") == nullptr);
+
+    const AssetTocEntry *mesh = archive.find("mesh.obj");
+    std::vector<unsigned char> blob = meshBlob(3, 3, 3, 3);
+    CHECK(sameBytes(archive, mesh, blob.data(), blob.size()));
+    AssetMeshHeader header;
+    CHECK(mesh != nullptr && archive.meshHeader(*mesh, sizeof(TestVertex), header));
+    CHECK(header.vertex_count == 3 && header.vertex_index_count == 3 && header.uv_index_count == 3);
+    // Only a MESH entry has a mesh header
+    CHECK(image != nullptr && !archive.meshHeader(*image, sizeof(TestVertex), header));
+
+    for (const char *name : {"font.ttf", "shader.glsl", "image.png", "mesh.obj"})
+    {
+        const AssetTocEntry *entry = archive.find(name);
+        CHECK(entry != nullptr && entry->offset % ASSET_BLOB_ALIGNMENT == 0);
+    }
+
+    archive.close();
+    CHECK(!archive.isOpen());
+    CHECK(archive.find("font.ttf") == nullptr);
+}
+
+// The table of contents runs past the end of the file
+static void testTruncatedToc()
+{
+    const std::string bytes = readFile(scratchPath("valid.pak"));
+    const std::string path = scratchPath("truncated.pak");
+    writeFile(path, bytes.substr(0, sizeof(AssetArchiveHeader) + sizeof(AssetTocEntry) / 2));
+    AssetArchive archive;
+    CHECK(!archive.open(path));
+    CHECK(!archive.isOpen());
+
+    // A complete file whose header claims more entries than it holds
+    std::string inflated = bytes;
+    const uint32_t entry_count = 1000000;
+    memcpy(&inflated[offsetof(AssetArchiveHeader, entry_count)], &entry_count, sizeof(entry_count));
+    writeFile(path, inflated);
+    CHECK(!archive.open(path));
+
+    // Shorter than the header itself
+    writeFile(path, bytes.substr(0, sizeof(AssetArchiveHeader) - 1));
+    CHECK(!archive.open(path));
+}
+
+static void testBadImageSize()
+{
+    const std::string path = scratchPath("bad_image.pak");
+    AssetArchiveWriter writer;
+    writer.add("image.png", "", ASSET_TYPE::IMAGE_RGBA, PIXELS, sizeof(PIXELS) - 1, 2, 3);
+    CHECK(writer.write(path));
+    AssetArchive archive;
+    CHECK(!archive.open(path));
+
+    AssetArchiveWriter empty_image;
+    empty_image.add("image.png", "", ASSET_TYPE::IMAGE_RGBA, PIXELS, 0, 0, 0);
+    CHECK(empty_image.write(path));
+    CHECK(!archive.open(path));
+}
+
+static void testInflatedMesh()
+{
+    // Counts that claim more vertices than the entry holds
+    const std::string path = scratchPath("bad_mesh.pak");
+    std::vector<unsigned char> inflated = meshBlob(1000000, 3, 3, 3);
+    AssetArchiveWriter writer;
+    writer.add("mesh.obj", "", ASSET_TYPE::MESH, inflated.data(), inflated.size());
+    CHECK(writer.write(path));
+    AssetArchive archive;
+    CHECK(archive.open(path));
+    const AssetTocEntry *mesh = archive.find("mesh.obj");
+    AssetMeshHeader header;
+    CHECK(mesh != nullptr && !archive.meshHeader(*mesh, sizeof(TestVertex), header));
+    // The right counts with the wrong vertex size do not fit either
+    std::vector<unsigned char> blob = meshBlob(3, 3, 3, 3);
+    AssetArchiveWriter exact;
+    exact.add("mesh.obj", "", ASSET_TYPE::MESH, blob.data(), blob.size());
+    CHECK(exact.write(path));
+    CHECK(archive.open(path));
+    mesh = archive.find("mesh.obj");
+    CHECK(mesh != nullptr && !archive.meshHeader(*mesh, sizeof(TestVertex) + 4, header));
+
+    // Counts that leave bytes unused are as wrong as ones that run over
+    std::vector<unsigned char> deflated = meshBlob(2, 3, 3, 3);
+    AssetArchiveWriter short_counts;
+    short_counts.add("mesh.obj", "", ASSET_TYPE::MESH, deflated.data(), deflated.size());
+    CHECK(short_counts.write(path));
+    CHECK(archive.open(path));
+    mesh = archive.find("mesh.obj");
+    CHECK(mesh != nullptr && !archive.meshHeader(*mesh, sizeof(TestVertex), header));
+
+    // Too small for the header is rejected on open
+    AssetArchiveWriter tiny;
+    tiny.add("mesh.obj", "", ASSET_TYPE::MESH, blob.data(), sizeof(AssetMeshHeader) - 1);
+    CHECK(tiny.write(path));
+    CHECK(!archive.open(path));
+}
+
+static void testOldVersion()
+{
+    std::string bytes = readFile(scratchPath("valid.pak"));
+    const uint32_t old_version = 1;
+    memcpy(&bytes[offsetof(AssetArchiveHeader, version)], &old_version, sizeof(old_version));
+    const std::string path = scratchPath("old_version.pak");
+    writeFile(path, bytes);
+    AssetArchive archive;
+    CHECK(!archive.open(path));
+
+    bytes = readFile(scratchPath("valid.pak"));
+    bytes[0] = 'X';
+    writeFile(path, bytes);
+    CHECK(!archive.open(path));
+}
+
+// Only the entry whose source changed is left out, the rest still come from the archive
+static void testStaleEntry()
+{
+    const std::string path = scratchPath("stale.pak");
+    CHECK(validArchive().write(path));
+
+    AssetArchive archive;
+    CHECK(archive.open(path, scratch_dir + "/"));
+    CHECK(archive.entryCount() == 4);
+
+    // Same size, newer modification time
+    int64_t mtime;
+    uint64_t size;
+    CHECK(assetSourceStamp(scratchPath("image.png"), mtime, size));
+    struct utimbuf times;
+    times.actime = (time_t)mtime + 100;
+    times.modtime = (time_t)mtime + 100;
+    CHECK(utime(scratchPath("image.png").c_str(), &times) == 0);
+
+    // A source that is gone is not stale, its entry is all there is
+    std::remove(scratchPath("font.ttf").c_str());
+
+    CHECK(archive.open(path, scratch_dir + "/"));
+    CHECK(archive.entryCount() == 3);
+    CHECK(archive.find("image.png") == nullptr);
+    CHECK(archive.find("font.ttf") != nullptr);
+    CHECK(archive.find("shader.glsl") != nullptr);
+    CHECK(archive.find("mesh.obj") != nullptr);
+
+    // Without a source dir nothing is checked
+    CHECK(archive.open(path));
+    CHECK(archive.entryCount() == 4);
+}
+
+// asset_archive_test <scratch dir>
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <scratch dir>\n", argv[0]);
+        return 1;
+    }
+    scratch_dir = argv[1];
+
+    testRoundtrip();
+    testTruncatedToc();
+    testBadImageSize();
+    testInflatedMesh();
+    testOldVersion();
+    testStaleEntry();
+    return testResult();
+}
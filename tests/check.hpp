@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdio>
+
+// Checks for the CPU test executables. A failed check is reported and the test goes on,
+// main returns testResult() so ctest sees the failure.
+
+static int check_failures = 0;
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            check_failures++; \
+        } \
+    } while (0)
+
+inline int testResult()
+{
+    if (check_failures > 0)
+        fprintf(stderr, "%d checks failed\n", check_failures);
+    return check_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,103 @@
+#include "dynamic_resolution.hpp"
+#include "check.hpp"
+
+#include <cmath>
+
+// A GPU whose frame cost is a fixed part plus a part that grows with the pixel count
+struct SimulatedGpu
+{
+    float fixed_ms;
+    float full_scale_ms;
+
+    float frameMs(float scale) const { return fixed_ms + full_scale_ms * scale * scale; }
+};
+
+static bool onStep(float scale)
+{
+    float steps = scale / DynamicResolution::SCALE_STEP;
+    return std::fabs(steps - std::round(steps)) < 1e-3f;
+}
+
+static float run(DynamicResolution &resolution, const SimulatedGpu &gpu, int frames)
+{
+    for (int i = 0; i < frames; i++)
+        resolution.update(gpu.frameMs(resolution.scale()));
+    return resolution.scale();
+}
+
+static void testUnderTargetKeepsFullScale()
+{
+    DynamicResolution resolution;
+    resolution.configure(14.f, 0.5f, 1.f);
+    resolution.reset(1.f);
+    CHECK(run(resolution, {1.f, 6.f}, 600) == 1.f);
+}
+
+static void testOnlyAdjustsEveryFewFrames()
+{
+    DynamicResolution resolution;
+    resolution.configure(14.f, 0.5f, 1.f);
+    resolution.reset(1.f);
+    int changes = 0;
+    float last = resolution.scale();
+    for (int i = 0; i < 300; i++)
+    {
+        float scale = resolution.update(40.f);
+        changes += scale != last;
+        last = scale;
+    }
+    // The first average is already over the target, so it drops on the first adjustment
+    CHECK(changes >= 1 && changes <= 300 / 30);
+    CHECK(resolution.scale() < 1.f);
+}
+
+static void testSettlesUnderTarget()
+{
+    DynamicResolution resolution;
+    resolution.configure(14.f, 0.5f, 1.f);
+    resolution.reset(1.f);
+    SimulatedGpu gpu = {2.f, 20.f};
+    float settled = run(resolution, gpu, 600);
+    CHECK(onStep(settled));
+    CHECK(gpu.frameMs(settled) <= 14.f);
+    // Not lower than it has to be: one step up would miss the target or sit in the headroom
+    CHECK(gpu.frameMs(settled + DynamicResolution::SCALE_STEP) >= 14.f * 0.8f);
+
+    // Once settled it stays put instead of bouncing between two scales
+    int moved = 0;
+    for (int i = 0; i < 600; i++)
+        moved += resolution.update(gpu.frameMs(resolution.scale())) != settled;
+    CHECK(moved == 0);
+}
+
+static void testClimbsBackWhenLoadDrops()
+{
+    DynamicResolution resolution;
+    resolution.configure(14.f, 0.5f, 1.f);
+    resolution.reset(1.f);
+    float low = run(resolution, {2.f, 30.f}, 600);
+    CHECK(low < 1.f);
+    CHECK(run(resolution, {1.f, 5.f}, 30 * 20) == 1.f);
+}
+
+static void testStaysInRange()
+{
+    DynamicResolution resolution;
+    resolution.configure(14.f, 0.5f, 1.f);
+    resolution.reset(1.f);
+    CHECK(run(resolution, {0.f, 1000.f}, 600) == 0.5f);
+    resolution.reset(2.f);
+    CHECK(resolution.scale() == 1.f);
+    resolution.reset(0.1f);
+    CHECK(resolution.scale() == 0.5f);
+}
+
+int main()
+{
+    testUnderTargetKeepsFullScale();
+    testOnlyAdjustsEveryFewFrames();
+    testSettlesUnderTarget();
+    testClimbsBackWhenLoadDrops();
+    testStaysInRange();
+    return testResult();
+}
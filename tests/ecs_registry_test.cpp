@@ -0,0 +1,95 @@
+#include "tiny_ecs_registry.hpp"
+#include "check.hpp"
+
+// Structural changes recorded while iterating a container wait for flush_deferred
+static void testDeferWhileIterating()
+{
+    ECSRegistry ecs;
+    Entity a, b, c;
+    ecs.motions.emplace(a);
+    ecs.motions.emplace(b);
+    ecs.motions.emplace(c);
+    ecs.healths.emplace(b);
+
+    size_t visited = 0;
+    for (Entity e : ecs.motions.entities)
+    {
+        visited++;
+        if (e == a)
+            ecs.defer([&ecs, a]() { ecs.healths.emplace(a); });
+        else if (e == b)
+            ecs.defer_remove_all_components_of(b);
+        else if (e == c)
+            ecs.defer([&ecs, c]() { ecs.motions.remove(c); });
+    }
+    CHECK(visited == 3);
+
+    // Nothing has changed yet
+    CHECK(ecs.motions.size() == 3);
+    CHECK(ecs.motions.has(a) && ecs.motions.has(b) && ecs.motions.has(c));
+    CHECK(!ecs.healths.has(a));
+    CHECK(ecs.healths.has(b));
+
+    ecs.flush_deferred();
+    CHECK(ecs.motions.size() == 1);
+    CHECK(ecs.motions.has(a));
+    CHECK(!ecs.motions.has(b) && !ecs.motions.has(c));
+    CHECK(ecs.healths.size() == 1);
+    CHECK(ecs.healths.has(a));
+    CHECK(!ecs.healths.has(b));
+
+    // The queues are empty after a flush
+    ecs.healths.remove(a);
+    ecs.flush_deferred();
+    CHECK(!ecs.healths.has(a));
+    CHECK(ecs.motions.size() == 1);
+}
+
+// Commands run in the order recorded, ones they record run in the same flush,
+// and the queued entities are destroyed after every command
+static void testFlushOrder()
+{
+    ECSRegistry ecs;
+    Entity a, b;
+    std::vector<int> order;
+    ecs.defer([&]() {
+        order.push_back(1);
+        ecs.defer([&]() { order.push_back(3); });
+    });
+    ecs.defer([&]() { order.push_back(2); });
+
+    ecs.defer_remove_all_components_of(a);
+    ecs.defer([&ecs, a]() { ecs.motions.emplace(a); });
+    ecs.defer([&ecs, b]() { ecs.motions.emplace(b); });
+    ecs.flush_deferred();
+
+    CHECK(order == std::vector<int>({1, 2, 3}));
+    CHECK(!ecs.motions.has(a));
+    CHECK(ecs.motions.has(b));
+}
+
+// Pending changes do not outlive a registry reset
+static void testClearDropsDeferred()
+{
+    ECSRegistry ecs;
+    Entity a, b;
+    ecs.motions.emplace(b);
+    ecs.defer([&ecs, a]() { ecs.motions.emplace(a); });
+    ecs.clear_all_components();
+    ecs.motions.emplace(b);
+    ecs.defer_remove_all_components_of(b);
+    ecs.clear_all_components();
+    ecs.motions.emplace(b);
+
+    ecs.flush_deferred();
+    CHECK(!ecs.motions.has(a));
+    CHECK(ecs.motions.has(b));
+}
+
+int main()
+{
+    testDeferWhileIterating();
+    testFlushOrder();
+    testClearDropsDeferred();
+    return testResult();
+}
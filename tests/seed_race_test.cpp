@@ -0,0 +1,72 @@
+#include "seed_race.hpp"
+#include "check.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <set>
+#include <thread>
+
+struct FakeMap
+{
+    int seed = 0;
+    bool succeeded = false;
+};
+
+// Succeeds only for the given offsets from first_seed. With slow_lowest the lowest of them
+// finishes last and has to replace a higher seed. Otherwise it waits for a higher success
+// to be running and finishes first, and the higher one must not replace it.
+static void checkRace(ThreadPool &pool, int first_seed, const std::set<unsigned int> &successes, bool slow_lowest)
+{
+    const unsigned int lowest = *successes.begin();
+    // Only another worker can start a higher success while the lowest one runs
+    const bool overlap = pool.size() > 1 && successes.size() > 1;
+    std::atomic<bool> higher_started(false);
+    auto attempt = [&](int seed, FakeMap &out) {
+        const unsigned int offset = (unsigned int)seed - (unsigned int)first_seed;
+        out.seed = seed;
+        out.succeeded = successes.count(offset) > 0;
+        if (!out.succeeded)
+            return false;
+        if (offset != lowest)
+            higher_started = true;
+        if ((offset == lowest) == slow_lowest)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        else if (overlap)
+            for (int i = 0; i < 50 && !higher_started; i++)
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return true;
+    };
+
+    FakeMap map;
+    SeedRaceStats stats = raceSeeds(pool, first_seed, attempt, map);
+    const int expected = (int)((unsigned int)first_seed + lowest);
+    CHECK(stats.seed == expected);
+    CHECK(stats.serial_attempts == lowest + 1);
+    CHECK(stats.attempts >= stats.serial_attempts);
+    // The result kept is the one from the winning seed
+    CHECK(map.succeeded && map.seed == expected);
+    // One worker tries the seeds in order, like the loop the race replaced
+    if (pool.size() == 1)
+        CHECK(stats.attempts == stats.serial_attempts);
+}
+
+int main()
+{
+    const std::vector<std::set<unsigned int>> success_sets = {
+        {0}, {1}, {5}, {3, 4, 9}, {6, 7, 8}, {17, 40}, {2, 3, 4, 5, 6, 7, 8, 9}};
+    // The last first seed makes the seeds wrap past INT_MAX
+    const int first_seeds[] = {0, 1234, INT_MAX - 2};
+    for (unsigned int threads : {1u, 2u, 3u, 8u})
+    {
+        ThreadPool pool(threads);
+        CHECK(pool.size() == threads);
+        // Races run back to back on one pool, like one room after the other
+        for (int round = 0; round < 2; round++)
+            for (int first_seed : first_seeds)
+                for (const std::set<unsigned int> &successes : success_sets)
+                    for (bool slow_lowest : {true, false})
+                        checkRace(pool, first_seed, successes, slow_lowest);
+    }
+    return testResult();
+}
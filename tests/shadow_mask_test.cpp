@@ -0,0 +1,193 @@
+#include "light_scene.hpp"
+#include "shadow_mask.hpp"
+#include "check.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using glm::vec2;
+
+// One pixel per SCENE_CELL world units, what F12 saves next to each scene
+static const float SCENE_CELL = 10.f;
+// Mean per pixel difference a golden image may drift by, rounding on another compiler
+static const float GOLDEN_TOLERANCE = 0.1f;
+
+static const unsigned char FULL_SHADOW = 51; // SHADOW_ALPHA * 255
+
+static std::string goldenPath(const std::string &scene_path)
+{
+    return scene_path.substr(0, scene_path.rfind('.')) + ".pgm";
+}
+
+static void testNoLight()
+{
+    ShadowMask mask;
+    mask.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    mask.rasterize(std::vector<const std::vector<vec2> *>());
+    for (unsigned char pixel : mask.pixels())
+        CHECK(pixel == FULL_SHADOW);
+}
+
+static void testFullyLit()
+{
+    ShadowMask mask;
+    mask.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    mask.rasterize({{0.f, 0.f}, {200.f, 0.f}, {200.f, 100.f}, {0.f, 100.f}});
+    for (unsigned char pixel : mask.pixels())
+        CHECK(pixel == 0);
+}
+
+// The polygon edge runs through the middle of column 10, which is half lit
+static void testPartialCoverage()
+{
+    ShadowMask mask;
+    mask.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    mask.rasterize({{0.f, 0.f}, {105.f, 0.f}, {105.f, 100.f}, {0.f, 100.f}});
+    for (int y = 0; y < mask.height(); y++)
+    {
+        for (int x = 0; x < mask.width(); x++)
+        {
+            if (x < 10)
+                CHECK(mask.at(x, y) == 0);
+            else if (x == 10)
+                CHECK(mask.at(x, y) == 26);
+            else
+                CHECK(mask.at(x, y) == FULL_SHADOW);
+        }
+    }
+}
+
+// Two lights lighting the same area count it once
+static void testUnion()
+{
+    std::vector<vec2> left = {{0.f, 0.f}, {120.f, 0.f}, {120.f, 100.f}, {0.f, 100.f}};
+    std::vector<vec2> right = {{80.f, 0.f}, {200.f, 0.f}, {200.f, 100.f}, {80.f, 100.f}};
+    ShadowMask mask;
+    mask.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    mask.rasterize(std::vector<const std::vector<vec2> *>{&left, &right});
+    for (unsigned char pixel : mask.pixels())
+        CHECK(pixel == 0);
+}
+
+static void testPGMRoundtrip(const std::string &scratch_dir)
+{
+    ShadowMask mask;
+    mask.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    mask.rasterize({{0.f, 0.f}, {130.f, 20.f}, {40.f, 90.f}});
+    const std::string path = scratch_dir + "/shadow_mask_test.pgm";
+    CHECK(mask.writePGM(path));
+
+    ShadowMask back;
+    CHECK(back.readPGM(path));
+    CHECK(back.width() == mask.width() && back.height() == mask.height());
+    CHECK(back.pixels() == mask.pixels());
+    CHECK(ShadowMask::difference(mask, back) == 0.f);
+
+    ShadowMask other;
+    other.resize(20, 10, vec2(0.f), vec2(200.f, 100.f));
+    other.rasterize(std::vector<const std::vector<vec2> *>());
+    CHECK(ShadowMask::difference(mask, other) > 0.f);
+    other.resize(10, 10, vec2(0.f), vec2(100.f, 100.f));
+    CHECK(ShadowMask::difference(mask, other) == -1.f);
+    std::remove(path.c_str());
+}
+
+static void testSceneRoundtrip(const std::string &scratch_dir)
+{
+    LightScene scene;
+    scene.room_size = vec2(300.f, 200.f);
+    // Values that only survive the text format if it keeps every digit
+    scene.occluders = {{{100.f, 50.f}, {100.f, 150.f}},
+                       {{200.f, 80.f}, {220.1f, 80.f}}, {{220.1f, 80.f}, {210.f, 1.f / 0.0107f}},
+                       {{210.f, 1.f / 0.0107f}, {200.f, 80.f}}};
+    scene.wall_count = 1;
+    scene.outlines = {{1, 3}};
+    scene.lights = {{{50.f, 100.f}, 0.f}, {{250.f, 1.f / 3.f}, 120.f}};
+    const std::string path = scratch_dir + "/shadow_mask_test.scene";
+    CHECK(scene.write(path));
+
+    LightScene back;
+    CHECK(back.read(path));
+    CHECK(back.room_size == scene.room_size);
+    CHECK(back.wall_count == scene.wall_count);
+    CHECK(back.outlines == scene.outlines);
+    CHECK(back.occluders.size() == scene.occluders.size());
+    for (size_t i = 0; i < back.occluders.size() && i < scene.occluders.size(); i++)
+        CHECK(back.occluders[i].a == scene.occluders[i].a && back.occluders[i].b == scene.occluders[i].b);
+    CHECK(back.lights.size() == scene.lights.size());
+    for (size_t i = 0; i < back.lights.size() && i < scene.lights.size(); i++)
+        CHECK(back.lights[i].position == scene.lights[i].position && back.lights[i].radius == scene.lights[i].radius);
+
+    // The light at x 50 only sees the left of the wall at x 100
+    ShadowMask mask;
+    LightSceneRenderer renderer;
+    renderer.rasterize(back, SCENE_CELL, mask);
+    CHECK(mask.width() == 30 && mask.height() == 20);
+    CHECK(mask.at(2, 10) == 0);
+    CHECK(mask.at(14, 14) == FULL_SHADOW);
+    std::remove(path.c_str());
+}
+
+// Each recorded scene has to render the same as its golden image
+static void testGolden(const std::vector<std::string> &scenes)
+{
+    CHECK(!scenes.empty());
+    LightSceneRenderer renderer;
+    for (const std::string &scene_path : scenes)
+    {
+        LightScene scene;
+        ShadowMask golden, mask;
+        bool loaded = scene.read(scene_path) && golden.readPGM(goldenPath(scene_path));
+        CHECK(loaded);
+        if (!loaded)
+            continue;
+        renderer.rasterize(scene, SCENE_CELL, mask);
+        float difference = ShadowMask::difference(golden, mask);
+        if (difference < 0.f || difference > GOLDEN_TOLERANCE)
+            fprintf(stderr, "%s differs from its golden image by %f\n", scene_path.c_str(), difference);
+        CHECK(difference >= 0.f && difference <= GOLDEN_TOLERANCE);
+    }
+}
+
+// Rewrites the golden images, for when the light pass is meant to look different
+static int updateGolden(const std::vector<std::string> &scenes)
+{
+    LightSceneRenderer renderer;
+    for (const std::string &scene_path : scenes)
+    {
+        LightScene scene;
+        ShadowMask mask;
+        if (!scene.read(scene_path))
+            return 1;
+        renderer.rasterize(scene, SCENE_CELL, mask);
+        if (!mask.writePGM(goldenPath(scene_path)))
+            return 1;
+        printf("Updated %s\n", goldenPath(scene_path).c_str());
+    }
+    return 0;
+}
+
+// shadow_mask_test <scratch dir> <scene>...
+// shadow_mask_test --update <scene>...
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <scratch dir> <scene>... | --update <scene>...\n", argv[0]);
+        return 1;
+    }
+    std::vector<std::string> scenes(argv + 2, argv + argc);
+    if (strcmp(argv[1], "--update") == 0)
+        return updateGolden(scenes);
+
+    testNoLight();
+    testFullyLit();
+    testPartialCoverage();
+    testUnion();
+    testPGMRoundtrip(argv[1]);
+    testSceneRoundtrip(argv[1]);
+    testGolden(scenes);
+    return testResult();
+}
@@ -0,0 +1,151 @@
+#include "sprite_batch.hpp"
+#include "check.hpp"
+
+#include <vector>
+
+// The instance remembers the order it was submitted in through its color
+static SpriteInstance instance(int order)
+{
+    SpriteInstance i;
+    i.transform = glm::mat3(1.f);
+    i.color = glm::vec3((float)order, 0.f, 0.f);
+    i.uv_rect = glm::vec4(0.f, 0.f, 1.f, 1.f);
+    return i;
+}
+
+static int order(const SpriteInstance &i)
+{
+    return (int)i.color.x;
+}
+
+// Keys a sprite pass could have, the same ones every run
+static std::vector<SpriteBatchKey> spriteKeys(int count)
+{
+    std::vector<SpriteBatchKey> keys;
+    unsigned int state = 12345;
+    for (int i = 0; i < count; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        unsigned int r = state >> 16;
+        keys.push_back({r % 2, (r >> 1) % 3, (r >> 3) % 4, (r >> 5) % 2});
+    }
+    return keys;
+}
+
+// Batches are in key order, cover instances() back to back and each holds the sprites
+// of its key in the order they were added
+static void checkBuilt(const SpriteBatchBuilder &builder, const std::vector<SpriteBatchKey> &keys)
+{
+    const std::vector<SpriteInstance> &instances = builder.instances();
+    const std::vector<SpriteBatch> &batches = builder.batches();
+    CHECK(instances.size() == keys.size());
+
+    unsigned int next = 0;
+    for (size_t b = 0; b < batches.size(); b++)
+    {
+        const SpriteBatch &batch = batches[b];
+        CHECK(batch.first_instance == next);
+        CHECK(batch.instance_count > 0);
+        if (b > 0)
+            CHECK(batches[b - 1].key < batch.key);
+        next += batch.instance_count;
+
+        int last = -1;
+        for (unsigned int i = batch.first_instance; i < batch.first_instance + batch.instance_count && i < instances.size(); i++)
+        {
+            int submitted = order(instances[i]);
+            CHECK(submitted > last);
+            CHECK(keys[submitted] == batch.key);
+            last = submitted;
+        }
+    }
+    CHECK(next == instances.size());
+}
+
+static void testSortsByKey()
+{
+    SpriteBatchBuilder builder;
+    const SpriteBatchKey a = {0, 0, 5, 1};
+    const SpriteBatchKey b = {0, 1, 2, 0};
+    const SpriteBatchKey c = {0, 1, 2, 1};
+    const SpriteBatchKey d = {0, 1, 3, 0};
+    std::vector<SpriteBatchKey> keys = {d, c, a, b, c, a};
+    for (size_t i = 0; i < keys.size(); i++)
+        builder.add(keys[i], instance((int)i));
+    builder.build();
+
+    // Effect first, then texture, then geometry
+    const std::vector<SpriteBatch> &batches = builder.batches();
+    CHECK(batches.size() == 4);
+    if (batches.size() == 4)
+    {
+        CHECK(batches[0].key == a && batches[0].instance_count == 2);
+        CHECK(batches[1].key == b && batches[1].instance_count == 1);
+        CHECK(batches[2].key == c && batches[2].instance_count == 2);
+        CHECK(batches[3].key == d && batches[3].instance_count == 1);
+    }
+    std::vector<int> sorted;
+    for (const SpriteInstance &i : builder.instances())
+        sorted.push_back(order(i));
+    CHECK(sorted == std::vector<int>({2, 5, 3, 1, 4, 0}));
+    checkBuilt(builder, keys);
+}
+
+// A lower layer is drawn first whatever its other keys
+static void testLayerFirst()
+{
+    SpriteBatchBuilder builder;
+    builder.add({1, 0, 0, 0}, instance(0));
+    builder.add({0, 2, 7, 1}, instance(1));
+    builder.build();
+    CHECK(builder.batches().size() == 2);
+    CHECK(order(builder.instances()[0]) == 1);
+    CHECK(order(builder.instances()[1]) == 0);
+}
+
+static void testManySprites()
+{
+    std::vector<SpriteBatchKey> keys = spriteKeys(500);
+    SpriteBatchBuilder builder;
+    for (size_t i = 0; i < keys.size(); i++)
+        builder.add(keys[i], instance((int)i));
+    builder.build();
+    checkBuilt(builder, keys);
+}
+
+// A second frame sees only its own sprites
+static void testClearAndRebuild()
+{
+    SpriteBatchBuilder builder;
+    for (int i = 0; i < 10; i++)
+        builder.add({0, (unsigned int)i % 3, 0, 0}, instance(i));
+    builder.build();
+
+    builder.clear();
+    CHECK(builder.instances().empty());
+    CHECK(builder.batches().empty());
+    builder.build();
+    CHECK(builder.instances().empty());
+    CHECK(builder.batches().empty());
+
+    std::vector<SpriteBatchKey> keys = {{0, 4, 1, 0}, {0, 4, 1, 0}};
+    builder.add(keys[0], instance(0));
+    builder.add(keys[1], instance(1));
+    builder.build();
+    CHECK(builder.batches().size() == 1);
+    checkBuilt(builder, keys);
+
+    // Building twice without a clear gives the same batches, not doubled ones
+    builder.build();
+    CHECK(builder.batches().size() == 1);
+    checkBuilt(builder, keys);
+}
+
+int main()
+{
+    testSortsByKey();
+    testLayerFirst();
+    testManySprites();
+    testClearAndRebuild();
+    return testResult();
+}
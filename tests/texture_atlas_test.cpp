@@ -0,0 +1,142 @@
+#include "texture_atlas.hpp"
+#include "check.hpp"
+
+#include <cstring>
+
+// Sizes a sprite set could have, the same ones every run
+static std::vector<glm::ivec2> spriteSizes(int count, int max_side)
+{
+    std::vector<glm::ivec2> sizes;
+    unsigned int state = 12345;
+    for (int i = 0; i < count; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        int w = 1 + (state >> 16) % max_side;
+        state = state * 1103515245u + 12345u;
+        int h = 1 + (state >> 16) % max_side;
+        sizes.push_back(glm::ivec2(w, h));
+    }
+    return sizes;
+}
+
+// Every image with its padding lies inside its page and no two of them overlap
+static void checkLayout(const std::vector<glm::ivec2> &sizes, int max_size, int padding, const AtlasLayout &layout)
+{
+    CHECK(layout.placements.size() == sizes.size());
+    for (size_t i = 0; i < sizes.size(); i++)
+    {
+        const AtlasPlacement &a = layout.placements[i];
+        CHECK(a.page >= 0 && a.page < (int)layout.page_sizes.size());
+        const glm::ivec2 page_size = layout.page_sizes[a.page];
+        CHECK(page_size.x <= max_size && page_size.y <= max_size);
+        CHECK(a.x - padding >= 0 && a.y - padding >= 0);
+        CHECK(a.x + sizes[i].x + padding <= page_size.x);
+        CHECK(a.y + sizes[i].y + padding <= page_size.y);
+
+        for (size_t j = i + 1; j < sizes.size(); j++)
+        {
+            const AtlasPlacement &b = layout.placements[j];
+            if (a.page != b.page)
+                continue;
+            bool apart = a.x + sizes[i].x + padding <= b.x - padding || b.x + sizes[j].x + padding <= a.x - padding ||
+                         a.y + sizes[i].y + padding <= b.y - padding || b.y + sizes[j].y + padding <= a.y - padding;
+            CHECK(apart);
+        }
+    }
+}
+
+static void testNoOverlap()
+{
+    const std::vector<glm::ivec2> sizes = spriteSizes(200, 48);
+    AtlasLayout layout;
+    CHECK(packAtlas(sizes, 512, 1, layout));
+    checkLayout(sizes, 512, 1, layout);
+}
+
+static void testPadding()
+{
+    const std::vector<glm::ivec2> sizes = spriteSizes(60, 20);
+    for (int padding = 0; padding <= 4; padding++)
+    {
+        AtlasLayout layout;
+        CHECK(packAtlas(sizes, 256, padding, layout));
+        checkLayout(sizes, 256, padding, layout);
+    }
+
+    // The padding repeats the image's border pixels and nothing past it is written
+    const int padding = 2;
+    const glm::ivec2 size(2, 2);
+    const unsigned char rgba[16] = {1, 1, 1, 1, 2, 2, 2, 2,
+                                    3, 3, 3, 3, 4, 4, 4, 4};
+    const glm::ivec2 page_size(10, 10);
+    std::vector<unsigned char> page(page_size.x * page_size.y * 4, 0);
+    const AtlasPlacement placement = {0, 3, 3};
+    blitIntoAtlas(page, page_size, rgba, size, placement, padding);
+    for (int y = 0; y < page_size.y; y++)
+    {
+        for (int x = 0; x < page_size.x; x++)
+        {
+            const unsigned char value = page[(y * page_size.x + x) * 4];
+            const bool covered = x >= 1 && x < 7 && y >= 1 && y < 7;
+            if (!covered)
+            {
+                CHECK(value == 0);
+                continue;
+            }
+            const int src_x = x < 4 ? 0 : 1;
+            const int src_y = y < 4 ? 0 : 1;
+            CHECK(value == rgba[(src_y * size.x + src_x) * 4]);
+        }
+    }
+}
+
+static void testPageOverflow()
+{
+    // Four 60x60 images fill a 128 page with padding 2, the fifth starts a new one
+    const std::vector<glm::ivec2> sizes(5, glm::ivec2(60, 60));
+    AtlasLayout layout;
+    CHECK(packAtlas(sizes, 128, 2, layout));
+    checkLayout(sizes, 128, 2, layout);
+    CHECK(layout.page_sizes.size() == 2);
+    CHECK(layout.placements[4].page == 1);
+    CHECK(layout.page_sizes[1] == glm::ivec2(64, 64));
+
+    const std::vector<glm::ivec2> many = spriteSizes(300, 60);
+    CHECK(packAtlas(many, 128, 1, layout));
+    checkLayout(many, 128, 1, layout);
+    CHECK(layout.page_sizes.size() > 1);
+
+    // Too large for a page once padded
+    CHECK(!packAtlas({glm::ivec2(127, 10)}, 128, 1, layout));
+    CHECK(packAtlas({glm::ivec2(126, 10)}, 128, 1, layout));
+}
+
+static void testDeterministic()
+{
+    const std::vector<glm::ivec2> sizes = spriteSizes(150, 40);
+    AtlasLayout first, second;
+    CHECK(packAtlas(sizes, 256, 1, first));
+    CHECK(packAtlas(sizes, 256, 1, second));
+    CHECK(first.page_sizes == second.page_sizes);
+    bool same = first.placements.size() == second.placements.size();
+    for (size_t i = 0; same && i < first.placements.size(); i++)
+        same = memcmp(&first.placements[i], &second.placements[i], sizeof(AtlasPlacement)) == 0;
+    CHECK(same);
+
+    // Tallest first, images of the same height keep their order
+    AtlasLayout layout;
+    CHECK(packAtlas({glm::ivec2(10, 10), glm::ivec2(5, 20), glm::ivec2(10, 10)}, 64, 1, layout));
+    CHECK(layout.placements[1].x == 1 && layout.placements[1].y == 1);
+    CHECK(layout.placements[0].x == 8 && layout.placements[0].y == 1);
+    CHECK(layout.placements[2].x == 20 && layout.placements[2].y == 1);
+    CHECK(layout.page_sizes[0] == glm::ivec2(31, 22));
+}
+
+int main()
+{
+    testNoOverlap();
+    testPadding();
+    testPageOverflow();
+    testDeterministic();
+    return testResult();
+}
@@ -0,0 +1,202 @@
+#include "visibility.hpp"
+#include "check.hpp"
+
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+using glm::vec2;
+
+static float cross(vec2 a, vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static float polygonArea(const std::vector<vec2> &polygon)
+{
+    float area = 0.f;
+    for (size_t i = 0; i < polygon.size(); i++)
+        area += cross(polygon[i], polygon[(i + 1) % polygon.size()]);
+    return area / 2.f;
+}
+
+static bool insidePolygon(const std::vector<vec2> &polygon, vec2 p)
+{
+    bool inside = false;
+    for (size_t i = 0, j = polygon.size() - 1; i < polygon.size(); j = i++)
+    {
+        vec2 a = polygon[i], b = polygon[j];
+        if ((a.y > p.y) != (b.y > p.y) && p.x < a.x + (p.y - a.y) / (b.y - a.y) * (b.x - a.x))
+            inside = !inside;
+    }
+    return inside;
+}
+
+static float distanceToSegment(vec2 p, vec2 a, vec2 b)
+{
+    vec2 d = b - a;
+    float t = glm::clamp(glm::dot(p - a, d) / glm::dot(d, d), 0.f, 1.f);
+    return glm::length(p - (a + t * d));
+}
+
+static float distanceToOutline(const std::vector<vec2> &polygon, vec2 p)
+{
+    float closest = INFINITY;
+    for (size_t i = 0; i < polygon.size(); i++)
+        closest = std::min(closest, distanceToSegment(p, polygon[i], polygon[(i + 1) % polygon.size()]));
+    return closest;
+}
+
+// The reference the sweep has to agree with: p is seen unless a segment crosses the sight line
+static bool seenByBruteForce(vec2 origin, vec2 p, const std::vector<VisibilitySegment> &segments)
+{
+    for (const VisibilitySegment &s : segments)
+    {
+        float d1 = cross(s.b - s.a, origin - s.a);
+        float d2 = cross(s.b - s.a, p - s.a);
+        float d3 = cross(p - origin, s.a - origin);
+        float d4 = cross(p - origin, s.b - origin);
+        if (((d1 > 0.f) != (d2 > 0.f)) && ((d3 > 0.f) != (d4 > 0.f)))
+            return false;
+    }
+    return true;
+}
+
+static void addBox(std::vector<VisibilitySegment> &segments, vec2 min, vec2 max)
+{
+    segments.push_back({min, {max.x, min.y}});
+    segments.push_back({{max.x, min.y}, max});
+    segments.push_back({max, {min.x, max.y}});
+    segments.push_back({{min.x, max.y}, min});
+}
+
+// Counterclockwise around the origin, every vertex on or inside the bounds
+static void checkShape(const std::vector<vec2> &polygon, vec2 origin, vec2 bounds_min, vec2 bounds_max)
+{
+    CHECK(polygon.size() >= 3);
+    CHECK(polygonArea(polygon) > 0.f);
+    float previous = -1.f;
+    bool ordered = true;
+    bool bounded = true;
+    for (vec2 p : polygon)
+    {
+        vec2 d = p - origin;
+        float angle = std::atan2(d.y, d.x);
+        if (angle < 0.f)
+            angle += 2.f * (float)M_PI;
+        // The first vertex can sit just below the +x axis
+        if (previous < 0.f && angle > 2.f * (float)M_PI - 1e-3f)
+            angle = 0.f;
+        ordered = ordered && angle >= previous - 1e-4f;
+        previous = angle;
+        bounded = bounded && p.x >= bounds_min.x - 1e-2f && p.y >= bounds_min.y - 1e-2f &&
+                  p.x <= bounds_max.x + 1e-2f && p.y <= bounds_max.y + 1e-2f;
+    }
+    CHECK(ordered);
+    CHECK(bounded);
+}
+
+static void testEmptyRoom()
+{
+    VisibilitySweep sweep;
+    std::vector<vec2> polygon;
+    const vec2 bounds_min(0.f), bounds_max(800.f, 600.f);
+    sweep.compute({300.f, 200.f}, {}, bounds_min, bounds_max, polygon);
+    checkShape(polygon, {300.f, 200.f}, bounds_min, bounds_max);
+    CHECK(std::fabs(polygonArea(polygon) - 800.f * 600.f) < 1.f);
+}
+
+static void testShadowBehindWall()
+{
+    VisibilitySweep sweep;
+    std::vector<vec2> polygon;
+    const vec2 origin(100.f, 300.f);
+    const std::vector<VisibilitySegment> wall = {{{400.f, 200.f}, {400.f, 400.f}}};
+    sweep.compute(origin, wall, vec2(0.f), vec2(800.f, 600.f), polygon);
+    checkShape(polygon, origin, vec2(0.f), vec2(800.f, 600.f));
+    CHECK(insidePolygon(polygon, {350.f, 300.f}));
+    CHECK(!insidePolygon(polygon, {600.f, 300.f}));
+    CHECK(insidePolygon(polygon, {600.f, 100.f}));
+
+    // The shadow is the wedge from the origin past the wall to the room's right side
+    const float shadow = 0.5f * (200.f + 200.f * 700.f / 300.f) * 400.f;
+    CHECK(std::fabs(800.f * 600.f - polygonArea(polygon) - shadow) < 1.f);
+}
+
+// Boxes on a coarse grid like the room's wall tiles, compared against brute force
+static void testMatchesBruteForce()
+{
+    const vec2 bounds_min(0.f), bounds_max(1000.f, 600.f);
+    unsigned int state = 7;
+    auto next = [&state]() {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) & 0x7fff;
+    };
+
+    for (int scene = 0; scene < 20; scene++)
+    {
+        std::vector<VisibilitySegment> segments;
+        std::vector<bool> solid(20 * 12, false);
+        for (int y = 1; y < 11; y++)
+            for (int x = 1; x < 19; x++)
+                if (next() % 6 == 0)
+                {
+                    solid[y * 20 + x] = true;
+                    addBox(segments, vec2(x, y) * 50.f + 5.f, vec2(x + 1, y + 1) * 50.f - 5.f);
+                }
+
+        VisibilitySweep sweep;
+        std::vector<vec2> polygon;
+        for (int light = 0; light < 5; light++)
+        {
+            int cell;
+            do
+                cell = next() % (20 * 12);
+            while (solid[cell]);
+            const vec2 origin = vec2(cell % 20, cell / 20) * 50.f + vec2(25.f + light, 25.f - light);
+            sweep.compute(origin, segments, bounds_min, bounds_max, polygon);
+            checkShape(polygon, origin, bounds_min, bounds_max);
+
+            int mismatches = 0;
+            for (int sample = 0; sample < 400; sample++)
+            {
+                vec2 p(next() % 1000, next() % 600);
+                p += 0.37f;
+                // Right on an outline either answer is fine
+                if (distanceToOutline(polygon, p) < 0.5f)
+                    continue;
+                bool near_segment = false;
+                for (const VisibilitySegment &s : segments)
+                    near_segment = near_segment || distanceToSegment(p, s.a, s.b) < 0.5f;
+                if (near_segment)
+                    continue;
+                if (insidePolygon(polygon, p) != seenByBruteForce(origin, p, segments))
+                    mismatches++;
+            }
+            CHECK(mismatches == 0);
+        }
+    }
+}
+
+static void testRepeatable()
+{
+    std::vector<VisibilitySegment> segments;
+    addBox(segments, {200.f, 200.f}, {260.f, 260.f});
+    addBox(segments, {500.f, 100.f}, {520.f, 400.f});
+    VisibilitySweep sweep;
+    std::vector<vec2> first, second;
+    sweep.compute({100.f, 300.f}, segments, vec2(0.f), vec2(800.f, 600.f), first);
+    // A call in between must not leave anything behind
+    sweep.compute({700.f, 50.f}, segments, vec2(0.f), vec2(800.f, 600.f), second);
+    sweep.compute({100.f, 300.f}, segments, vec2(0.f), vec2(800.f, 600.f), second);
+    CHECK(first == second);
+}
+
+int main()
+{
+    testEmptyRoom();
+    testShadowBehindWall();
+    testMatchesBruteForce();
+    testRepeatable();
+    return testResult();
+}
@@ -0,0 +1,144 @@
+#include "wall_edges.hpp"
+#include "check.hpp"
+
+#include <cmath>
+
+#include <glm/geometric.hpp>
+
+using glm::vec2;
+
+static float cross(vec2 a, vec2 b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+static bool solidAt(const std::vector<unsigned char> &solid, int width, int height, vec2 p, vec2 tile_size)
+{
+    int x = (int)std::floor(p.x / tile_size.x);
+    int y = (int)std::floor(p.y / tile_size.y);
+    if (x < 0 || y < 0 || x >= width || y >= height)
+        return true;
+    return solid[y * width + x] != 0;
+}
+
+// Grid lines between a solid and an open cell, counted cell side by cell side
+static int openSides(const std::vector<unsigned char> &solid, int width, int height)
+{
+    auto at = [&](int x, int y) { return x < 0 || y < 0 || x >= width || y >= height || solid[y * width + x] != 0; };
+    int sides = 0;
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++)
+            if (!at(x, y))
+                sides += at(x - 1, y) + at(x + 1, y) + at(x, y - 1) + at(x, y + 1);
+    return sides;
+}
+
+static void testSingleCell()
+{
+    const vec2 tile(50.f, 50.f);
+    std::vector<unsigned char> solid = {1, 1, 1,
+                                        1, 0, 1,
+                                        1, 1, 1};
+    std::vector<VisibilitySegment> edges;
+    extractWallEdges(solid, 3, 3, tile, edges);
+    CHECK(edges.size() == 4);
+    for (const VisibilitySegment &e : edges)
+    {
+        CHECK(std::fabs(glm::length(e.b - e.a) - 50.f) < 1e-4f);
+        CHECK(cross(e.b - e.a, vec2(75.f, 75.f) - e.a) > 0.f);
+    }
+}
+
+static void testRunsMerge()
+{
+    // A corridor through the middle, every side of it is one straight edge
+    const vec2 tile(50.f, 50.f);
+    std::vector<unsigned char> solid = {1, 1, 1, 1, 1,
+                                        0, 0, 0, 0, 0,
+                                        1, 1, 1, 1, 1};
+    std::vector<VisibilitySegment> edges;
+    extractWallEdges(solid, 5, 3, tile, edges);
+    CHECK(edges.size() == 4);
+    int long_edges = 0;
+    for (const VisibilitySegment &e : edges)
+        long_edges += std::fabs(glm::length(e.b - e.a) - 250.f) < 1e-4f;
+    CHECK(long_edges == 2);
+}
+
+// Random grids: edges lie on grid lines, cover every open side exactly once, face the
+// open cell and are merged as far as they go
+static void testRandomGrids()
+{
+    const vec2 tile(50.f, 40.f);
+    unsigned int state = 99;
+    for (int grid = 0; grid < 50; grid++)
+    {
+        const int width = 3 + grid % 11;
+        const int height = 2 + grid % 7;
+        std::vector<unsigned char> solid(width * height);
+        for (unsigned char &cell : solid)
+        {
+            state = state * 1103515245u + 12345u;
+            cell = ((state >> 16) % 3) == 0;
+        }
+
+        std::vector<VisibilitySegment> edges;
+        extractWallEdges(solid, width, height, tile, edges);
+
+        float length = 0.f;
+        bool on_grid = true, faces_open = true, merged = true;
+        for (const VisibilitySegment &e : edges)
+        {
+            const vec2 d = e.b - e.a;
+            const bool horizontal = d.y == 0.f;
+            on_grid = on_grid && (horizontal || d.x == 0.f) &&
+                      std::fmod(horizontal ? e.a.y : e.a.x, horizontal ? tile.y : tile.x) == 0.f;
+            length += horizontal ? std::fabs(d.x) / tile.x : std::fabs(d.y) / tile.y;
+
+            // Just off the middle of each tile side along the edge
+            const vec2 normal = glm::normalize(vec2(-d.y, d.x));
+            const vec2 step = glm::normalize(d) * (horizontal ? tile.x : tile.y);
+            const int tiles = (int)std::lround(glm::length(d) / (horizontal ? tile.x : tile.y));
+            for (int i = 0; i < tiles; i++)
+            {
+                const vec2 middle = e.a + step * (i + 0.5f);
+                faces_open = faces_open && !solidAt(solid, width, height, middle + normal, tile) &&
+                             solidAt(solid, width, height, middle - normal, tile);
+            }
+
+            for (const VisibilitySegment &other : edges)
+                if (other.a == e.b && glm::normalize(other.b - other.a) == glm::normalize(d))
+                    merged = false;
+        }
+        CHECK(on_grid);
+        CHECK(faces_open);
+        CHECK(merged);
+        CHECK(std::lround(length) == openSides(solid, width, height));
+    }
+}
+
+static void testSegmentBlocked()
+{
+    const vec2 tile(50.f, 50.f);
+    std::vector<unsigned char> solid = {0, 0, 0, 0,
+                                        0, 1, 1, 0,
+                                        0, 0, 0, 0};
+    std::vector<VisibilitySegment> edges;
+    extractWallEdges(solid, 4, 3, tile, edges);
+    CHECK(!segmentBlocked({25.f, 25.f}, {175.f, 25.f}, edges));
+    CHECK(segmentBlocked({25.f, 25.f}, {175.f, 125.f}, edges));
+    CHECK(segmentBlocked({100.f, 10.f}, {100.f, 140.f}, edges));
+    // Touching a corner counts
+    CHECK(segmentBlocked({25.f, 25.f}, {50.f, 50.f}, edges));
+    // The grid border is left to the caller
+    CHECK(!segmentBlocked({25.f, 25.f}, {25.f, 125.f}, edges));
+}
+
+int main()
+{
+    testSingleCell();
+    testRunsMerge();
+    testRandomGrids();
+    testSegmentBlocked();
+    return testResult();
+}
@@ -0,0 +1,123 @@
+// Offline asset baker: packs textures, meshes, shaders and fonts into one archive
+// so the game can map it at startup instead of decoding and parsing every file.
+//
+// usage: asset-baker <project dir> <output archive> <asset paths relative to the project dir...>
+
+#include "asset_archive.hpp"
+#include "components.hpp"
+
+#include "../ext/stb_image/stb_image.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static bool hasExtension(const std::string &path, const std::string &extension)
+{
+    return path.size() >= extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+static bool readFile(const std::string &path, std::string &out)
+{
+    std::ifstream is(path, std::ios::binary);
+    if (!is.good())
+        return false;
+    std::ostringstream ss;
+    ss << is.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// Decoded and flipped exactly like the runtime did with stbi_load, so uploads can use it as is
+static bool bakeImage(AssetArchiveWriter &writer, const std::string &name, const std::string &path)
+{
+    int width, height;
+    stbi_set_flip_vertically_on_load(true);
+    stbi_uc *pixels = stbi_load(path.c_str(), &width, &height, NULL, 4);
+    if (pixels == NULL)
+        return false;
+    writer.add(name, path, ASSET_TYPE::IMAGE_RGBA, pixels, (size_t)width * height * 4, width, height);
+    stbi_image_free(pixels);
+    return true;
+}
+
+static bool bakeMesh(AssetArchiveWriter &writer, const std::string &name, const std::string &path)
+{
+    std::vector<TexturedVertex> vertices;
+    std::vector<uint16_t> vertex_indices;
+    std::vector<uint16_t> uv_indices;
+    vec2 original_size;
+    if (!Mesh::loadFromOBJFile(path, vertices, vertex_indices, uv_indices, original_size))
+        return false;
+
+    AssetMeshHeader header;
+    header.vertex_count = (uint32_t)vertices.size();
+    header.vertex_index_count = (uint32_t)vertex_indices.size();
+    header.uv_index_count = (uint32_t)uv_indices.size();
+    header.original_size[0] = original_size.x;
+    header.original_size[1] = original_size.y;
+
+    std::vector<unsigned char> blob(sizeof(header));
+    memcpy(blob.data(), &header, sizeof(header));
+    auto append = [&blob](const void *bytes, size_t size) {
+        const unsigned char *begin = (const unsigned char *)bytes;
+        blob.insert(blob.end(), begin, begin + size);
+    };
+    append(vertices.data(), vertices.size() * sizeof(TexturedVertex));
+    append(vertex_indices.data(), vertex_indices.size() * sizeof(uint16_t));
+    append(uv_indices.data(), uv_indices.size() * sizeof(uint16_t));
+
+    writer.add(name, path, ASSET_TYPE::MESH, blob.data(), blob.size());
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fprintf(stderr, "usage: %s <project dir> <output archive> <assets...>\n", argv[0]);
+        return 1;
+    }
+    std::string project_dir = argv[1];
+    if (!project_dir.empty() && project_dir.back() != '/')
+        project_dir += '/';
+
+    AssetArchiveWriter writer;
+    for (int i = 3; i < argc; i++)
+    {
+        std::string name = assetName(project_dir, argv[i]);
+        std::string path = project_dir + name;
+        if (name.size() >= ASSET_NAME_LENGTH)
+        {
+            fprintf(stderr, "Asset path too long for the archive: %s\n", name.c_str());
+            return 1;
+        }
+
+        bool ok;
+        if (hasExtension(name, ".png"))
+            ok = bakeImage(writer, name, path);
+        else if (hasExtension(name, ".obj"))
+            ok = bakeMesh(writer, name, path);
+        else
+        {
+            std::string bytes;
+            ok = readFile(path, bytes);
+            if (ok)
+                writer.add(name, path, hasExtension(name, ".glsl") ? ASSET_TYPE::SHADER : ASSET_TYPE::RAW, bytes.data(), bytes.size());
+        }
+        if (!ok)
+        {
+            fprintf(stderr, "Could not bake %s\n", path.c_str());
+            return 1;
+        }
+    }
+
+    if (!writer.write(argv[2]))
+        return 1;
+    printf("Baked %d assets into %s\n", argc - 3, argv[2]);
+    return 0;
+}
@@ -0,0 +1,73 @@
+// Light pass benchmark: replays recorded scenes (F12 in game, or data/light_scenes) and
+// times the visibility polygons and the shadow mask separately, with no GPU involved.
+//
+// usage: light-benchmark [-n frames] <scene files...>
+
+#include "light_scene.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Same resolution the golden images use
+static const float SCENE_CELL = 10.f;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    int frames = 1000;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+            frames = std::max(1, atoi(argv[++i]));
+        else
+            paths.push_back(argv[i]);
+    }
+    if (paths.empty())
+    {
+        fprintf(stderr, "usage: %s [-n frames] <scene files...>\n", argv[0]);
+        return 1;
+    }
+
+    printf("%-48s %8s %8s %12s %12s\n", "scene", "lights", "edges", "polygons ms", "mask ms");
+    LightSceneRenderer renderer;
+    ShadowMask mask;
+    for (const std::string &path : paths)
+    {
+        LightScene scene;
+        if (!scene.read(path))
+            return 1;
+
+        // One untimed frame so the buffers have grown to their steady size
+        renderer.rasterize(scene, SCENE_CELL, mask);
+
+        size_t vertices = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            for (const std::vector<glm::vec2> &polygon : renderer.computePolygons(scene))
+                vertices += polygon.size();
+        double polygons_ms = millisecondsSince(start) / frames;
+
+        // rasterize recomputes the polygons, the mask cost is what it adds on top
+        start = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; frame++)
+            renderer.rasterize(scene, SCENE_CELL, mask);
+        double mask_ms = millisecondsSince(start) / frames - polygons_ms;
+
+        printf("%-48s %8zu %8zu %12.4f %12.4f\n", path.c_str(), scene.lights.size(), scene.occluders.size(),
+               polygons_ms, mask_ms);
+        // Keeps the polygon loop from being optimized away
+        if (vertices == 0)
+            printf("  no light reaches anything\n");
+    }
+    return 0;
+}